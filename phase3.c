@@ -5,231 +5,1654 @@
 #include <string.h>
 #include <phase3_usermode.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <time.h>
+
+// Semaphores are allocated in chunks the size of the original MAXSEMS table
+#define SEM_CHUNK_SIZE  MAXSEMS
+#define MAX_SEM_CHUNKS  64
+#define SEM_REPORT_TOP  10 // Semaphores listed by the report at halt
+
+// Reasons a process blocked in P can be woken up
+#define WAKE_V          0 // A V made a unit available
+#define WAKE_FREED      1 // The semaphore was freed out from under the waiter
+#define WAKE_TIMEOUT    2 // A SemTimedP deadline passed first
+#define WAKE_HANDOFF    3 // A V on a SEM_HANDOFF semaphore already took the units on the waiter's behalf
+#define WAKE_KILLED     4 // An ancestor terminated, so the waiter has to terminate too
+
+// Returned internally by wait_for_child when WAIT_NOHANG finds nothing ready
+#define WAIT_NOT_READY  1
+
+// Worker pool behind SubmitWork
+#define WORKER_POOL_MAX 8   // Workers are created on demand, up to this many
+#define WORK_QUEUE_SIZE 64  // Submitted tasks that no worker has picked up yet
+#define WORK_SUBMIT     0   // arg3 of SYS_SUBMITWORK from SubmitWork
+#define WORK_FETCH      1   // arg3 of SYS_SUBMITWORK from a pool worker asking for its next task
 
 // Data structures and global variables
+
+// Status of a child that join() has already returned, kept until a Wait or WaitPid reports it
+typedef struct ExitRecord
+{
+    int pid;
+    int status;
+} ExitRecord;
+
+// Per-process state, indexed by pid % MAXPROC
+// A slot is cleared when its process is reaped, so a Spawned child always starts from zeroes
 typedef struct ProcessData
 {
+    int pid;
+    int priority; // Priority given to Spawn, or 0 if the process wasn't created by Spawn
+
     int (*user_func)(void *);
     void *user_arg;
 
-    struct ProcessData *next;
+    struct ProcessData *next;       // Next process in a semaphore's wait queue
+    struct Semaphore *waiting_on;   // Semaphore whose queue this process is on, or NULL
+    int units;                      // Number of units this process is waiting to take
+    int in_semop;                   // Waiting in SemOp, so units must not be handed to it directly
+    int wake_reason;                // Set by whoever removes this process from a wait queue
+
+    struct ProcessData *timed_next; // Next process on the SemTimedP deadline list
+    int deadline;                   // currentTime() at which a SemTimedP gives up
+
+    struct ProcessData *parent;       // Set by the child itself, so it's valid even before Spawn returns
+    struct ProcessData *children;     // Spawned children that haven't been joined yet, not counting detached ones
+    struct ProcessData *next_sibling; // Set by the parent when it links the child in
+    int num_children;                 // Length of the children list
+    int num_exited;                   // Children that have terminated but haven't been joined yet
+    int detached;                     // Spawned detached, so the parent joins us without reporting us to a Wait
+    struct ProcessData *detached_children; // Detached children that haven't been joined yet, linked the same way
+    int num_detached;                 // Length of the detached_children list
+    int num_detached_exited;          // Of those, the ones that have terminated
+    int exited;                       // Terminated, so the parent's join() won't block on us
+    int terminating;                  // In terminate_current(), waiting for children before quitting
+    int killed;                       // An ancestor called TerminateTree, so this process is being torn down
+
+    // Children already joined but not yet reported to a Wait, oldest first
+    // Each one still counts against MAXPROC until it's reported, like the zombie it replaces, so this can't overflow
+    ExitRecord reaped[MAXPROC];
+    int num_reaped;
+
+    // Accounting for Sys_GetProcInfo, kept up to date by account_switch()
+    int stack_size;                   // Given to Spawn, or 0 if the process wasn't created by Spawn
+    int in_syscall;                   // Syscall number while inside one, else 0
+    int off_cpu_since;                // currentTime() when the process last lost the CPU
+    int cpu_time;
+    int blocked_sem;
+    int blocked_wait;
+    int blocked_io;
+    int syscalls;
+    int context_switches;
 } ProcessData;
 
-typedef struct Semaphore
+// Everything a new process needs at startup, staged by Spawn before the child can run
+// Handed to the trampoline through spork's arg, so the child never has to wait for its parent
+typedef struct StartupData
+{
+    int (*user_func)(void *);
+    void *user_arg;
+    int priority;
+    int stack_size;
+    int detached;
+    ProcessData *parent;
+
+    struct StartupData *next_free;
+} StartupData;
+
+// A task handed to SubmitWork, queued until a pool worker picks it up
+typedef struct WorkItem
+{
+    int (*func)(void *);
+    void *arg;
+
+    struct WorkItem *next; // Next in the work queue, or on the free list
+} WorkItem;
+
+typedef struct Semaphore
+{
+    // Touched by every P and V, so these come first and share a cache line with the counters below
+    int value;
+    int num_waiting;
+    int flags; // SEM_* flags given to SemCreateFlags
+    int in_use;
+    int generation; // Bumped whenever the semaphore is freed, so a woken waiter can tell its sid was reused
+    int num_woken;  // Waiters a V has woken that haven't run yet
+
+    // FIFO of processes blocked in P, linked through ProcessData.next
+    ProcessData *wait_head;
+    ProcessData *wait_tail;
+
+    // Contention counters, see SemStats
+    int p_count;
+    int blocked_count;
+    int max_waiting;
+    int max_blocked;
+    long long total_blocked;
+
+    int sid;
+    char name[SEM_NAME_MAX]; // Set by SemName, empty otherwise
+
+    struct Semaphore *next_free; // Next semaphore on the free list, while not in use
+} __attribute__((aligned(64))) Semaphore;
+
+static Semaphore semaphores[SEM_CHUNK_SIZE];           // First chunk, always present
+static Semaphore *semaphore_chunks[MAX_SEM_CHUNKS];    // All chunks, indexed by sid / SEM_CHUNK_SIZE
+static int num_semaphore_chunks;
+static Semaphore *free_semaphores;                     // Free list of unused semaphores
+static int num_semaphores_in_use;                      // Only SEM_GROW semaphores may push this past MAXSEMS
+static ProcessData process_data[MAXPROC];
+static StartupData startup_data[MAXPROC];              // At most one per process that hasn't started yet
+static StartupData *free_startup_data;
+static ProcessData *timed_waiters;                     // SemTimedP waiters, sorted by deadline
+static WorkItem work_items[WORK_QUEUE_SIZE];
+static WorkItem *free_work_items;
+static WorkItem *work_head;                            // FIFO of submitted tasks
+static WorkItem *work_tail;
+static int idle_workers[WORKER_POOL_MAX];              // PIDs of workers blocked waiting for a task
+static int num_idle_workers;
+static int num_workers;
+static void (*phase2_clock_handler)(int dev, void *arg);
+static void (*interrupt_handlers[USLOSS_NUM_INTS])(int dev, void *arg); // What interrupt_entry dispatches to
+static void (*instrumented_handlers[MAXSYSCALLS])(USLOSS_Sysargs *args); // What syscall_stats_entry dispatches to
+static SyscallStat syscall_stats[MAXSYSCALLS];
+static int syscall_stats_enabled;
+static int running_pid;                                // Process account_switch() last saw on the CPU
+static int running_since;                              // currentTime() when it got the CPU
+static UserDataPage user_page;                         // Written only by the kernel, see update_user_page()
+
+// User mode reads the data page through this, without a syscall
+const volatile UserDataPage *const user_data_page = &user_page;
+
+// Forward declarations
+void terminate_current(int status, int flags) __attribute__((__noreturn__));
+void check_killed();
+void kill_descendants(ProcessData *parent);
+void reap_detached();
+
+// Helpers
+
+// Disables interrupts, returning the old PSR so the caller can restore it
+// Semaphore state is only touched inside these critical sections, since USLOSS is uniprocessor
+unsigned int disable_interrupts()
+{
+    unsigned int old_psr = USLOSS_PsrGet();
+    if (USLOSS_PsrSet(old_psr & ~USLOSS_PSR_CURRENT_INT) != USLOSS_ERR_OK)
+    {
+        USLOSS_Console("ERROR: Could not disable interrupts.\n");
+        USLOSS_Halt(1);
+    }
+    return old_psr;
+}
+
+// Restores the PSR saved by disable_interrupts()
+void restore_interrupts(unsigned int old_psr)
+{
+    if (USLOSS_PsrSet(old_psr) != USLOSS_ERR_OK)
+    {
+        USLOSS_Console("ERROR: Could not restore interrupts.\n");
+        USLOSS_Halt(1);
+    }
+}
+
+// Takes a startup record off the free list, or returns NULL if none are left
+// Must be called with interrupts disabled
+StartupData *alloc_startup_data()
+{
+    StartupData *startup = free_startup_data;
+    if (startup != NULL)
+        free_startup_data = startup->next_free;
+    return startup;
+}
+
+// Puts a startup record back on the free list
+// Must be called with interrupts disabled
+void release_startup_data(StartupData *startup)
+{
+    startup->next_free = free_startup_data;
+    free_startup_data = startup;
+}
+
+// Adds a chunk of semaphores to the table and pushes them onto the free list
+// Returns -1 if the table can't grow any further
+int add_semaphore_chunk(Semaphore *chunk)
+{
+    if (num_semaphore_chunks == MAX_SEM_CHUNKS)
+        return -1;
+
+    int base = num_semaphore_chunks * SEM_CHUNK_SIZE;
+    semaphore_chunks[num_semaphore_chunks++] = chunk;
+
+    // Push in reverse so that the lowest sids are handed out first
+    memset(chunk, 0, sizeof(Semaphore) * SEM_CHUNK_SIZE);
+    for (int i = SEM_CHUNK_SIZE - 1; i >= 0; i--)
+    {
+        chunk[i].sid = base + i;
+        chunk[i].next_free = free_semaphores;
+        free_semaphores = &chunk[i];
+    }
+
+    return 0;
+}
+
+// Pops a semaphore off the free list, growing the table by a chunk if it is empty
+// Returns NULL if no semaphore could be allocated; must be called with interrupts disabled
+Semaphore *alloc_semaphore()
+{
+    if (free_semaphores == NULL)
+    {
+        Semaphore *chunk = aligned_alloc(__alignof__(Semaphore), sizeof(Semaphore) * SEM_CHUNK_SIZE);
+        if (chunk == NULL || add_semaphore_chunk(chunk) == -1)
+        {
+            free(chunk);
+            return NULL;
+        }
+    }
+
+    Semaphore *semaphore = free_semaphores;
+    free_semaphores = semaphore->next_free;
+    semaphore->next_free = NULL;
+    semaphore->in_use = 1;
+    num_semaphores_in_use++;
+
+    return semaphore;
+}
+
+// Pushes an unused semaphore back onto the free list
+// Must be called with interrupts disabled
+void release_semaphore(Semaphore *semaphore)
+{
+    semaphore->in_use = 0;
+    semaphore->generation++;
+    num_semaphores_in_use--;
+    semaphore->next_free = free_semaphores;
+    free_semaphores = semaphore;
+}
+
+// Looks up an in-use semaphore by sid, or returns NULL if the sid is invalid
+Semaphore *get_semaphore(int sid)
+{
+    if (sid < 0 || sid >= num_semaphore_chunks * SEM_CHUNK_SIZE)
+        return NULL;
+
+    Semaphore *semaphore = &semaphore_chunks[sid / SEM_CHUNK_SIZE][sid % SEM_CHUNK_SIZE];
+    return semaphore->in_use ? semaphore : NULL;
+}
+
+// Returns a process's priority for SEM_PRIORITY ordering, where lower numbers are more urgent
+// Processes not created by Spawn (such as start3) have no recorded priority, so they go last
+int waiter_priority(ProcessData *waiter)
+{
+    return waiter->priority == 0 ? INT_MAX : waiter->priority;
+}
+
+// Adds the current process to the semaphore's wait queue, waiting for the given number of units
+// Normally this is the tail; on a SEM_PRIORITY semaphore it goes after every waiter of the same or higher priority
+// Must be called with interrupts disabled
+void enqueue_waiter(Semaphore *semaphore, int units)
+{
+    ProcessData *self = &process_data[getpid() % MAXPROC];
+    self->pid = getpid();
+    self->next = NULL;
+    self->waiting_on = semaphore;
+    self->units = units;
+    self->in_semop = 0;
+
+    ProcessData *prev = semaphore->wait_tail;
+    if (semaphore->flags & SEM_PRIORITY)
+    {
+        int my_priority = waiter_priority(self);
+
+        prev = NULL;
+        for (ProcessData *cur = semaphore->wait_head; cur != NULL && waiter_priority(cur) <= my_priority; cur = cur->next)
+            prev = cur;
+    }
+
+    if (prev == NULL)
+    {
+        self->next = semaphore->wait_head;
+        semaphore->wait_head = self;
+    }
+    else
+    {
+        self->next = prev->next;
+        prev->next = self;
+    }
+    if (self->next == NULL)
+        semaphore->wait_tail = self;
+
+    semaphore->num_waiting++;
+    if (semaphore->num_waiting > semaphore->max_waiting)
+        semaphore->max_waiting = semaphore->num_waiting;
+}
+
+// Removes the oldest process from the semaphore's wait queue and returns its PID
+// The reason is handed to the waiter so it knows why it woke up
+// Must be called with interrupts disabled, and only when num_waiting > 0
+int dequeue_waiter(Semaphore *semaphore, int reason)
+{
+    ProcessData *waiter = semaphore->wait_head;
+
+    semaphore->wait_head = waiter->next;
+    if (semaphore->wait_head == NULL)
+        semaphore->wait_tail = NULL;
+    waiter->next = NULL;
+    waiter->waiting_on = NULL;
+    waiter->wake_reason = reason;
+
+    semaphore->num_waiting--;
+    return waiter->pid;
+}
+
+// Removes a specific process from the middle of its semaphore's wait queue
+// Must be called with interrupts disabled, and only while the process is on a queue
+void remove_waiter(ProcessData *waiter, int reason)
+{
+    Semaphore *semaphore = waiter->waiting_on;
+    ProcessData *prev = NULL;
+    ProcessData *cur = semaphore->wait_head;
+
+    while (cur != waiter)
+    {
+        prev = cur;
+        cur = cur->next;
+    }
+
+    if (prev == NULL)
+        semaphore->wait_head = waiter->next;
+    else
+        prev->next = waiter->next;
+    if (semaphore->wait_tail == waiter)
+        semaphore->wait_tail = prev;
+
+    waiter->next = NULL;
+    waiter->waiting_on = NULL;
+    waiter->wake_reason = reason;
+
+    semaphore->num_waiting--;
+}
+
+// Inserts the current process into the deadline list, keeping it sorted by deadline
+// Must be called with interrupts disabled
+void add_timed_waiter(int deadline)
+{
+    ProcessData *self = &process_data[getpid() % MAXPROC];
+    self->deadline = deadline;
+
+    ProcessData **link = &timed_waiters;
+    while (*link != NULL && (*link)->deadline <= deadline)
+        link = &(*link)->timed_next;
+
+    self->timed_next = *link;
+    *link = self;
+}
+
+// Takes the current process off the deadline list, if it's still there
+// Must be called with interrupts disabled
+void remove_timed_waiter()
+{
+    ProcessData *self = &process_data[getpid() % MAXPROC];
+
+    ProcessData **link = &timed_waiters;
+    while (*link != NULL && *link != self)
+        link = &(*link)->timed_next;
+
+    if (*link != NULL)
+        *link = self->timed_next;
+    self->timed_next = NULL;
+}
+
+// Wakes waiters from the head of the queue for as long as the semaphore's value covers their requests
+// Stops at the first waiter that doesn't fit, so that large requests aren't starved by small ones
+// On a SEM_HANDOFF semaphore the units are taken here, so the woken P returns without re-checking
+// Must be called with interrupts disabled
+void wake_waiters(Semaphore *semaphore)
+{
+    int available = semaphore->value;
+    int waiters[MAXPROC];
+    int num_waiters = 0;
+
+    // Pick everyone first, since unblockProc() may switch to a woken process before we're done
+    while (semaphore->num_waiting > 0 && semaphore->wait_head->units <= available)
+    {
+        ProcessData *waiter = semaphore->wait_head;
+        available -= waiter->units;
+
+        if ((semaphore->flags & SEM_HANDOFF) && !waiter->in_semop)
+        {
+            semaphore->value -= waiter->units;
+            waiters[num_waiters++] = dequeue_waiter(semaphore, WAKE_HANDOFF);
+        }
+        else
+        {
+            semaphore->num_woken++;
+            waiters[num_waiters++] = dequeue_waiter(semaphore, WAKE_V);
+        }
+    }
+
+    for (int i = 0; i < num_waiters; i++)
+        unblockProc(waiters[i]);
+}
+
+// Records that a P is about to block on the semaphore, returning the time it started waiting
+// Must be called with interrupts disabled
+int note_block_start(Semaphore *semaphore)
+{
+    semaphore->blocked_count++;
+    return currentTime();
+}
+
+// Adds the time since start to the semaphore's blocked time
+// Must be called with interrupts disabled, and only while the semaphore is still in use
+void note_block_end(Semaphore *semaphore, int start)
+{
+    int elapsed = currentTime() - start;
+    semaphore->total_blocked += elapsed;
+    if (elapsed > semaphore->max_blocked)
+        semaphore->max_blocked = elapsed;
+}
+
+// Reads the unit count of a P or V from arg2
+// The plain SemP/SemV stubs pass 1; a count of 0 does nothing, and a negative count is an error
+int get_units(USLOSS_Sysargs *args)
+{
+    return (int)(long)args->arg2;
+}
+
+// Semaphore syscall handlers
+
+// Creates a new Semaphore with given arguments
+// arg2 holds SEM_* flags, which the plain SemCreate stub leaves zeroed
+// Only MAXSEMS semaphores may be in use at once, unless the new one is created with SEM_GROW
+void semaphore_create(USLOSS_Sysargs *args)
+{
+    int value = (int)(long)args->arg1;
+    int flags = (int)(long)args->arg2;
+
+    if (value < 0 || (flags & ~(SEM_HANDOFF | SEM_PRIORITY | SEM_GROW)) != 0) // Invalid starting value or unknown flags
+    {
+        args->arg1 = 0;
+        args->arg4 = (void *)-1;
+        return;
+    }
+
+    unsigned int old_psr = disable_interrupts();
+    Semaphore *target = NULL;
+    if (num_semaphores_in_use < MAXSEMS || (flags & SEM_GROW))
+        target = alloc_semaphore();
+
+    if (target == NULL) // At the MAXSEMS cap, or no free semaphores and the table is at its maximum size
+    {
+        args->arg1 = 0;
+        args->arg4 = (void *)-1;
+    }
+    else // Initialize semaphore
+    {
+        target->value = value;
+        target->flags = flags;
+
+        target->wait_head = NULL;
+        target->wait_tail = NULL;
+        target->num_waiting = 0;
+        target->num_woken = 0;
+
+        target->p_count = 0;
+        target->blocked_count = 0;
+        target->max_waiting = 0;
+        target->max_blocked = 0;
+        target->total_blocked = 0;
+        target->name[0] = '\0';
+
+        args->arg1 = (void *)(long)target->sid;
+        args->arg4 = 0;
+    }
+
+    restore_interrupts(old_psr);
+}
+
+// Performs the Semaphore V operation, releasing one or more units
+void semaphore_v(USLOSS_Sysargs *args)
+{
+    int sid = (int)(long)args->arg1;
+    int units = get_units(args);
+
+    unsigned int old_psr = disable_interrupts();
+
+    Semaphore *semaphore = get_semaphore(sid);
+    if (semaphore == NULL || units < 0) // Invalid semaphore or unit count
+    {
+        restore_interrupts(old_psr);
+        args->arg4 = (void *)-1;
+        return;
+    }
+
+    // A V of no units has nothing to release
+    if (units == 0)
+    {
+        restore_interrupts(old_psr);
+        args->arg4 = 0;
+        return;
+    }
+
+    // The counter is a plain int, so a V that would overflow it is rejected
+    if (semaphore->value > INT_MAX - units)
+    {
+        restore_interrupts(old_psr);
+        args->arg4 = (void *)-1;
+        return;
+    }
+
+    // Release the semaphore resources (increment the value)
+    semaphore->value += units;
+
+    // If any processes were blocked & waiting, then wake as many as the new value allows
+    if (semaphore->num_waiting > 0)
+        wake_waiters(semaphore);
+
+    restore_interrupts(old_psr);
+
+    args->arg4 = 0;
+}
+
+// Performs the Semaphore P operation, taking one or more units at once
+// arg3 selects whether it may block forever, not at all (SemTryP), or until a deadline (SemTimedP)
+// A SemTimedP whose timeout is zero or negative is a SemTryP, since its deadline has already passed
+void semaphore_p(USLOSS_Sysargs *args)
+{
+    int sid = (int)(long)args->arg1;
+    int units = get_units(args);
+    int mode = (int)(long)args->arg3;
+    int timeout = (int)(long)args->arg5;
+
+    if (mode == SEMP_TIMED && timeout <= 0)
+        mode = SEMP_TRY;
+
+    unsigned int old_psr = disable_interrupts();
+
+    Semaphore *semaphore = get_semaphore(sid);
+    if (semaphore == NULL || units < 0) // Invalid semaphore or unit count
+    {
+        restore_interrupts(old_psr);
+        args->arg4 = (void *)-1;
+        return;
+    }
+
+    // A P of no units always succeeds without taking anything
+    if (units == 0)
+    {
+        restore_interrupts(old_psr);
+        args->arg4 = 0;
+        return;
+    }
+
+    // Clamp the deadline, so that a huge timeout waits (practically) forever instead of overflowing
+    long long far_deadline = (long long)currentTime() + timeout;
+    int deadline = far_deadline > INT_MAX ? INT_MAX : (int)far_deadline;
+    int generation = semaphore->generation;
+    int block_start = -1;
+
+    semaphore->p_count++;
+
+    // On a SEM_HANDOFF semaphore, a new P never overtakes anyone already queued, even if there are units for it
+    int queue_behind = (semaphore->flags & SEM_HANDOFF) && semaphore->num_waiting > 0;
+
+    // If not enough resources, block until a V wakes us up
+    // Re-check after waking, since another process may have taken the resource in the meantime
+    while (queue_behind || semaphore->value < units)
+    {
+        queue_behind = 0;
+
+        int rc = 0;
+        if (mode == SEMP_TRY)
+            rc = SEM_ERR_WOULDBLOCK;
+        else if (mode == SEMP_TIMED && currentTime() >= deadline)
+            rc = SEM_ERR_TIMEOUT;
+
+        if (rc != 0)
+        {
+            if (block_start >= 0)
+                note_block_end(semaphore, block_start);
+            restore_interrupts(old_psr);
+            args->arg4 = (void *)(long)rc;
+            return;
+        }
+
+        if (block_start < 0)
+            block_start = note_block_start(semaphore);
+
+        enqueue_waiter(semaphore, units);
+        if (mode == SEMP_TIMED)
+            add_timed_waiter(deadline);
+
+        blockMe();
+
+        ProcessData *self = &process_data[getpid() % MAXPROC];
+        if (mode == SEMP_TIMED)
+            remove_timed_waiter();
+
+        // Whatever woke us, the semaphore may have been freed and its sid reused before we got to run
+        int same_semaphore = semaphore->in_use && semaphore->generation == generation;
+
+        if (self->wake_reason == WAKE_KILLED)
+            terminate_current(TERM_KILLED, TERM_TREE);
+
+        // The V already took our units for us
+        if (self->wake_reason == WAKE_HANDOFF)
+        {
+            if (same_semaphore)
+                note_block_end(semaphore, block_start);
+            restore_interrupts(old_psr);
+            args->arg4 = 0;
+            return;
+        }
+
+        // The clock handler has already taken us off the semaphore's queue
+        if (self->wake_reason == WAKE_TIMEOUT)
+        {
+            if (same_semaphore)
+                note_block_end(semaphore, block_start);
+            restore_interrupts(old_psr);
+            args->arg4 = (void *)SEM_ERR_TIMEOUT;
+            return;
+        }
+
+        // Don't touch a semaphore that was freed, whether SemFree found us on its queue or a V had already woken us
+        if (self->wake_reason == WAKE_FREED || !same_semaphore)
+        {
+            restore_interrupts(old_psr);
+            args->arg4 = (void *)SEM_ERR_FREED;
+            return;
+        }
+
+        semaphore->num_woken--;
+    }
+
+    // At this point, enough semaphore resources are available, so decrement the value
+    semaphore->value -= units;
+
+    if (block_start >= 0)
+        note_block_end(semaphore, block_start);
+
+    restore_interrupts(old_psr);
+
+    args->arg4 = 0;
+}
+
+// Frees a Semaphore, returning its slot to the free list
+// Any processes still blocked in P are woken up, and their P returns SEM_ERR_FREED
+// So does the P of a waiter that a V already woke but that hasn't run yet, which counts as blocked too
+void semaphore_free(USLOSS_Sysargs *args)
+{
+    int sid = (int)(long)args->arg1;
+
+    unsigned int old_psr = disable_interrupts();
+
+    Semaphore *semaphore = get_semaphore(sid);
+    if (semaphore == NULL) // Invalid semaphore
+    {
+        restore_interrupts(old_psr);
+        args->arg4 = (void *)-1;
+        return;
+    }
+
+    // Detach the whole wait queue before waking anyone, so that the slot is
+    // already back on the free list by the time any woken waiter runs
+    int had_waiters = semaphore->num_waiting > 0 || semaphore->num_woken > 0;
+    int waiters[MAXPROC];
+    int num_waiters = 0;
+    while (semaphore->num_waiting > 0)
+        waiters[num_waiters++] = dequeue_waiter(semaphore, WAKE_FREED);
+
+    release_semaphore(semaphore);
+
+    for (int i = 0; i < num_waiters; i++)
+        unblockProc(waiters[i]);
+
+    restore_interrupts(old_psr);
+
+    // Return 1 if processes were blocked on the semaphore, 0 otherwise
+    args->arg4 = (void *)(long)had_waiters;
+}
+
+// Performs a vector of semaphore operations atomically
+// Each entry adds delta units to its semaphore (a V if positive, a P if negative)
+// The caller blocks until every P in the vector can be satisfied at once, then all of them are applied together
+void semaphore_op(USLOSS_Sysargs *args)
+{
+    SemOpEntry *user_ops = args->arg1;
+    int count = (int)(long)args->arg2;
+
+    if (user_ops == NULL || count < 1 || count > SEMOP_MAX)
+    {
+        args->arg4 = (void *)-1;
+        return;
+    }
+
+    // Copy the vector, since the caller's array may change while we are blocked
+    SemOpEntry ops[SEMOP_MAX];
+    memcpy(ops, user_ops, sizeof(SemOpEntry) * count);
+
+    // Each semaphore may only appear once, so that its checks and updates can't interfere with each other
+    // A delta of INT_MIN is rejected too, since a P of that many units can't be negated into a unit count
+    for (int i = 0; i < count; i++)
+    {
+        if (ops[i].delta == INT_MIN)
+        {
+            args->arg4 = (void *)-1;
+            return;
+        }
+
+        for (int j = i + 1; j < count; j++)
+        {
+            if (ops[i].sid == ops[j].sid)
+            {
+                args->arg4 = (void *)-1;
+                return;
+            }
+        }
+    }
+
+    unsigned int old_psr = disable_interrupts();
+
+    // Look up every semaphore once, remembering its generation so that a reused sid is noticed after blocking
+    Semaphore *semaphores_used[SEMOP_MAX];
+    int generations[SEMOP_MAX];
+    for (int i = 0; i < count; i++)
+    {
+        semaphores_used[i] = get_semaphore(ops[i].sid);
+        if (semaphores_used[i] == NULL)
+        {
+            restore_interrupts(old_psr);
+            args->arg4 = (void *)-1;
+            return;
+        }
+        generations[i] = semaphores_used[i]->generation;
+    }
+
+    Semaphore *blocked_on = NULL;
+
+    while (1)
+    {
+        // Find the first P that can't be satisfied right now
+        int blocker = -1;
+        for (int i = 0; i < count; i++)
+        {
+            Semaphore *semaphore = semaphores_used[i];
+            int delta = ops[i].delta;
+
+            if (delta > 0 && semaphore->value > INT_MAX - delta)
+            {
+                // Pass on any wakeup we received, since we won't be using it
+                if (blocked_on != NULL)
+                    wake_waiters(blocked_on);
+
+                restore_interrupts(old_psr);
+                args->arg4 = (void *)-1;
+                return;
+            }
+
+            // As in semaphore_p, a P on a SEM_HANDOFF semaphore waits behind anyone already queued on it,
+            // unless it's the one a V just woke us from
+            int queue_behind = (semaphore->flags & SEM_HANDOFF) && semaphore->num_waiting > 0 && semaphore != blocked_on;
+
+            if (blocker < 0 && delta < 0 && (semaphore->value < -delta || queue_behind))
+                blocker = i;
+        }
+
+        if (blocker < 0)
+            break;
+
+        // We were woken for a semaphore we no longer need to wait on, so let its next waiter have a try
+        if (blocked_on != NULL && blocked_on != semaphores_used[blocker])
+            wake_waiters(blocked_on);
+
+        // Wait on the semaphore that is short; when it's V'ed, the whole vector is re-checked
+        ProcessData *self = &process_data[getpid() % MAXPROC];
+        Semaphore *semaphore = semaphores_used[blocker];
+        int block_start = note_block_start(semaphore);
+        enqueue_waiter(semaphore, -ops[blocker].delta);
+        self->in_semop = 1;
+        blocked_on = semaphore;
+        blockMe();
+
+        int same_semaphore = semaphore->in_use && semaphore->generation == generations[blocker];
+        if (same_semaphore)
+        {
+            note_block_end(semaphore, block_start);
+            if (self->wake_reason == WAKE_V)
+                semaphore->num_woken--;
+        }
+        else
+        {
+            blocked_on = NULL;
+        }
+
+        if (self->wake_reason == WAKE_KILLED)
+            terminate_current(TERM_KILLED, TERM_TREE);
+
+        // Any semaphore in the vector may have been freed, and its sid reused, while we were blocked
+        int freed = self->wake_reason == WAKE_FREED;
+        for (int i = 0; i < count && !freed; i++)
+            freed = !semaphores_used[i]->in_use || semaphores_used[i]->generation != generations[i];
+
+        if (freed)
+        {
+            if (blocked_on != NULL)
+                wake_waiters(blocked_on);
+
+            restore_interrupts(old_psr);
+            args->arg4 = (void *)SEM_ERR_FREED;
+            return;
+        }
+    }
+
+    // Every P can succeed, so apply the whole vector, then wake anyone the V's made room for
+    for (int i = 0; i < count; i++)
+    {
+        semaphores_used[i]->value += ops[i].delta;
+        if (ops[i].delta < 0)
+            semaphores_used[i]->p_count++;
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        if (ops[i].delta > 0 && semaphores_used[i]->num_waiting > 0)
+            wake_waiters(semaphores_used[i]);
+    }
+
+    restore_interrupts(old_psr);
+
+    args->arg4 = 0;
+}
+
+// Names a semaphore, for SemStats and the report at halt
+// Names longer than SEM_NAME_MAX - 1 characters are cut short
+void semaphore_name(USLOSS_Sysargs *args)
+{
+    int sid = (int)(long)args->arg1;
+    char *name = args->arg2;
+
+    unsigned int old_psr = disable_interrupts();
+
+    Semaphore *semaphore = get_semaphore(sid);
+    if (semaphore == NULL || name == NULL)
+    {
+        restore_interrupts(old_psr);
+        args->arg4 = (void *)-1;
+        return;
+    }
+
+    strncpy(semaphore->name, name, SEM_NAME_MAX - 1);
+    semaphore->name[SEM_NAME_MAX - 1] = '\0';
+
+    restore_interrupts(old_psr);
+
+    args->arg4 = 0;
+}
+
+// Fills stats[] with the most contended semaphores in use, most total blocked time first
+// Only semaphores that ever blocked anyone are listed; returns how many were filled in
+// Must be called with interrupts disabled
+int collect_sem_stats(SemStats *stats, int max)
+{
+    int count = 0;
+
+    for (int c = 0; c < num_semaphore_chunks; c++)
+    {
+        for (int i = 0; i < SEM_CHUNK_SIZE; i++)
+        {
+            Semaphore *semaphore = &semaphore_chunks[c][i];
+            if (!semaphore->in_use || semaphore->blocked_count == 0)
+                continue;
+
+            // Insertion into the sorted top-max list, dropping whatever falls off the end
+            int pos = count;
+            while (pos > 0 && stats[pos - 1].total_blocked < semaphore->total_blocked)
+                pos--;
+            if (pos == max)
+                continue;
+
+            if (count < max)
+                count++;
+            memmove(&stats[pos + 1], &stats[pos], sizeof(SemStats) * (count - pos - 1));
+
+            SemStats *entry = &stats[pos];
+            entry->sid = semaphore->sid;
+            memcpy(entry->name, semaphore->name, SEM_NAME_MAX);
+            entry->value = semaphore->value;
+            entry->p_count = semaphore->p_count;
+            entry->blocked_count = semaphore->blocked_count;
+            entry->max_waiting = semaphore->max_waiting;
+            entry->max_blocked = semaphore->max_blocked;
+            entry->total_blocked = semaphore->total_blocked;
+        }
+    }
+
+    return count;
+}
+
+// Handles the sem_stats syscall, copying the top arg2 contended semaphores into the array in arg1
+// arg1 returns how many were filled in
+void semaphore_stats(USLOSS_Sysargs *args)
+{
+    SemStats *stats = args->arg1;
+    int max = (int)(long)args->arg2;
+
+    if (stats == NULL || max < 0)
+    {
+        args->arg1 = 0;
+        args->arg4 = (void *)-1;
+        return;
+    }
+
+    unsigned int old_psr = disable_interrupts();
+    int count = collect_sem_stats(stats, max);
+    restore_interrupts(old_psr);
+
+    args->arg1 = (void *)(long)count;
+    args->arg4 = 0;
+}
+
+// Prints the most contended semaphores, if any semaphore was named or PHASE3_SEM_STATS is set
+void phase3_dump_sem_stats()
+{
+    SemStats stats[SEM_REPORT_TOP];
+    int named = 0;
+
+    for (int c = 0; c < num_semaphore_chunks && !named; c++)
+    {
+        for (int i = 0; i < SEM_CHUNK_SIZE; i++)
+        {
+            if (semaphore_chunks[c][i].in_use && semaphore_chunks[c][i].name[0] != '\0')
+            {
+                named = 1;
+                break;
+            }
+        }
+    }
+
+    if (!named && getenv("PHASE3_SEM_STATS") == NULL)
+        return;
+
+    unsigned int old_psr = disable_interrupts();
+    int count = collect_sem_stats(stats, SEM_REPORT_TOP);
+    restore_interrupts(old_psr);
+
+    USLOSS_Console("  sid name                  Ps  blocked  max waiting  max us  total us\n");
+    for (int i = 0; i < count; i++)
+    {
+        USLOSS_Console("%5d %-16s %7d %8d %12d %7d %9lld\n", stats[i].sid, stats[i].name, stats[i].p_count,
+                       stats[i].blocked_count, stats[i].max_waiting, stats[i].max_blocked, stats[i].total_blocked);
+    }
+}
+
+// Clock interrupt handler, installed in front of phase 2's
+// Times out any SemTimedP waiters whose deadline has passed, then lets phase 2 handle the tick as usual
+void clock_handler(int dev, void *arg)
+{
+    int now = currentTime();
+    int expired[MAXPROC];
+    int num_expired = 0;
+
+    unsigned int old_psr = disable_interrupts();
+
+    while (timed_waiters != NULL && timed_waiters->deadline <= now)
+    {
+        ProcessData *waiter = timed_waiters;
+        timed_waiters = waiter->timed_next;
+        waiter->timed_next = NULL;
+
+        // Skip waiters that a V or SemFree already woke, but that haven't run yet
+        if (waiter->waiting_on == NULL)
+            continue;
+
+        // If the waiter was at the head of the queue, the ones behind it may now fit
+        Semaphore *semaphore = waiter->waiting_on;
+        remove_waiter(waiter, WAKE_TIMEOUT);
+        wake_waiters(semaphore);
+
+        expired[num_expired++] = waiter->pid;
+    }
+
+    for (int i = 0; i < num_expired; i++)
+        unblockProc(expired[i]);
+
+    restore_interrupts(old_psr);
+
+    if (phase2_clock_handler != NULL)
+        phase2_clock_handler(dev, arg);
+
+    if ((USLOSS_PsrGet() & USLOSS_PSR_PREV_MODE) == 0)
+    {
+        // Free the slots of any detached children that terminated while we were running user code
+        old_psr = disable_interrupts();
+        reap_detached();
+        restore_interrupts(old_psr);
+
+    }
+}
+
+// Refreshes the user data page on the way out of the kernel
+// Only a return to user mode vouches for the page; anything else leaves it marked stale, so the stubs trap instead
+// Must be called with interrupts disabled
+void update_user_page()
+{
+    if (USLOSS_PsrGet() & USLOSS_PSR_PREV_MODE)
+    {
+        user_page.pid = 0;
+        return;
+    }
+
+    user_page.pid = getpid();
+}
+
+// Notices whether another process got the CPU since the last kernel entry or exit, and if so accounts for it
+// Phase 1's dispatcher can't be hooked, so switches are picked up at the next interrupt_entry boundary instead
+// The CPU time is charged to whoever had the CPU; time spent off it inside a syscall counts as blocked,
+// by the kind of syscall; time spent off it after a preemption is just waiting to run, and isn't counted
+// Must be called with interrupts disabled
+void account_switch()
+{
+    int pid = getpid();
+    if (pid == running_pid)
+        return;
+
+    int now = currentTime();
+
+    // The previous process may be gone already, in which case its slot has been cleared or reused
+    ProcessData *prev = &process_data[running_pid % MAXPROC];
+    if (running_pid > 0 && prev->pid == running_pid)
+    {
+        prev->cpu_time += now - running_since;
+        prev->off_cpu_since = now;
+    }
+
+    ProcessData *self = &process_data[pid % MAXPROC];
+    self->pid = pid;
+    self->context_switches++;
+
+    if (self->off_cpu_since != 0 && self->in_syscall != 0)
+    {
+        int blocked = now - self->off_cpu_since;
+
+        switch (self->in_syscall)
+        {
+        case SYS_SEMP:
+        case SYS_SEMOP:
+            self->blocked_sem += blocked;
+            break;
+        case SYS_WAIT:
+        case SYS_WAITPID:
+        case SYS_WAITALL:
+        case SYS_TERMINATE:
+            self->blocked_wait += blocked;
+            break;
+        case SYS_TERMREAD:
+        case SYS_TERMWRITE:
+        case SYS_SLEEP:
+        case SYS_DISKREAD:
+        case SYS_DISKWRITE:
+        case SYS_DISKSIZE:
+            self->blocked_io += blocked;
+            break;
+        default: // Mailboxes and the like aren't broken out
+            break;
+        }
+    }
+    self->off_cpu_since = 0;
+
+    running_pid = pid;
+    running_since = now;
+}
+
+// Installed in every interrupt vector (syscalls included), in front of the real handler
+// Every context switch away from a user process happens inside one of these, and every switch back returns
+// through one, so refreshing the data page on the way out keeps it current for whoever runs next
+void interrupt_entry(int dev, void *arg)
+{
+    unsigned int old_psr = disable_interrupts();
+    account_switch();
+    if (dev == USLOSS_SYSCALL_INT)
+    {
+        ProcessData *self = &process_data[getpid() % MAXPROC];
+        self->syscalls++;
+        self->in_syscall = ((USLOSS_Sysargs *)arg)->number;
+    }
+    restore_interrupts(old_psr);
+
+    // Whoever runs next without coming back through here (a brand new process) must not trust the page
+    user_page.pid = 0;
+
+    interrupt_handlers[dev](dev, arg);
+
+    old_psr = disable_interrupts();
+    account_switch();
+    if (dev == USLOSS_SYSCALL_INT)
+        process_data[getpid() % MAXPROC].in_syscall = 0;
+    update_user_page();
+    restore_interrupts(old_psr);
+
+    // A process being torn down stops here on its way back to user code, whether it made a syscall or was preempted
+    if ((USLOSS_PsrGet() & USLOSS_PSR_PREV_MODE) == 0)
+        check_killed();
+}
+
+// System call handlers
+
+// Trampoline function that handles calling the user mode process
+// Everything it needs was staged by Spawn before spork, so it can start right away
+int user_process_wrapper(void *arg)
+{
+    StartupData *startup = arg;
+    ProcessData *data = &process_data[getpid() % MAXPROC];
+
+    // Fill in our own process data from the staged record, then give the record back
+    // The slot was cleared when its last owner was reaped, and the parent may already have linked us in
+    unsigned int old_psr = disable_interrupts();
+    data->pid = getpid();
+    data->priority = startup->priority;
+    data->stack_size = startup->stack_size;
+    data->user_func = startup->user_func;
+    data->user_arg = startup->user_arg;
+    data->detached = startup->detached;
+    data->parent = startup->parent;
+    release_startup_data(startup);
+    restore_interrupts(old_psr);
+
+    // Start charging our CPU time to us rather than to whoever ran before
+    old_psr = disable_interrupts();
+    account_switch();
+    restore_interrupts(old_psr);
+
+    // Our parent may have been torn down before we ever got to run
+    check_killed();
+
+    // We're about to enter user mode without returning through interrupt_entry, so vouch for the page here
+    // If an interrupt slips in before the switch, its exit marks the page stale again, which is only slower
+    old_psr = disable_interrupts();
+    user_page.pid = data->pid;
+    restore_interrupts(old_psr);
+
+    // Enable user mode
+    USLOSS_PsrSet(USLOSS_PsrGet() & ~0x1);
+
+    // Call user mode function
+    int status = data->user_func(data->user_arg);
+
+    // Terminate if the above function returns
+    Terminate(status);
+    return 0; // Terminate() never returns
+}
+
+// Creates one child running func(arg) in user mode, returning its PID or -1 on failure
+// A detached child is ours in phase 1 like any other, but it's joined as soon as we notice it has terminated
+// (see reap_detached), and Wait never reports it
+int spawn_child(char *name, int (*func)(void *), void *arg, int stack_size, int priority, int detached)
+{
+    ProcessData *self = &process_data[getpid() % MAXPROC];
+
+    // Make room first, in case detached children that have already terminated are still holding their slots
+    unsigned int old_psr = disable_interrupts();
+    reap_detached();
+    restore_interrupts(old_psr);
+
+    // Children we've joined but haven't reported yet still count against MAXPROC, so the reaped table can't fill up
+    if (self->num_children + self->num_detached + self->num_reaped >= MAXPROC)
+        return -1;
+
+    // Stage the data the trampoline function will need before the child exists, since it may run immediately
+    old_psr = disable_interrupts();
+    StartupData *startup = alloc_startup_data();
+    restore_interrupts(old_psr);
+
+    if (startup == NULL)
+        return -1;
+
+    startup->user_func = func;
+    startup->user_arg = arg;
+    startup->priority = priority;
+    startup->stack_size = stack_size;
+    startup->detached = detached;
+    startup->parent = self;
+
+    // Spork process using the trampoline function instead
+    int pid = spork(name, user_process_wrapper, startup, stack_size, priority);
+
+    old_psr = disable_interrupts();
+
+    if (pid < 0) // The child was never created, so nobody else will release the record
+    {
+        release_startup_data(startup);
+        restore_interrupts(old_psr);
+        return -1;
+    }
+
+    // Track the child, so that WaitPid can find it without scanning the process table
+    // It may already have run (or even terminated), but it never touches these fields itself
+    // Detached children go on a list of their own, which only a TerminateTree walks
+    ProcessData *child = &process_data[pid % MAXPROC];
+    child->pid = pid;
+    if (detached)
+    {
+        child->next_sibling = self->detached_children;
+        self->detached_children = child;
+        self->num_detached++;
+    }
+    else
+    {
+        child->next_sibling = self->children;
+        self->children = child;
+        self->num_children++;
+    }
+
+    restore_interrupts(old_psr);
+
+    return pid;
+}
+
+// Handles the spawn syscall
+void spawn_handler(USLOSS_Sysargs *args)
+{
+    int pid = spawn_child(args->arg5, args->arg1, args->arg2, (long)args->arg3, (long)args->arg4, 0);
+
+    // Return args
+    if (pid < 0) // Error creating child
+    {
+        args->arg1 = (void *)-1;
+        args->arg4 = 0;
+    }
+    else
+    {
+        args->arg1 = (void *)(long)pid;
+        args->arg4 = 0;
+    }
+}
+
+// Handles the spawn_many syscall, creating several children in one kernel entry
+// Stops at the first child that can't be created; arg1 returns how many were, and the rest of pids[] is set to -1
+// SpawnDetached comes through here too, as a request for one detached child
+void spawn_many_handler(USLOSS_Sysargs *args)
 {
-    int in_use;
-    int value;
+    SpawnManyArgs *request = args->arg1;
 
-    int mutex_mailbox;
-    int waiting_mailbox;
+    if (request == NULL || request->func == NULL || request->pids == NULL || request->count < 0)
+    {
+        args->arg1 = 0;
+        args->arg4 = (void *)-1;
+        return;
+    }
 
-    int num_waiting;
-} Semaphore;
+    int spawned = 0;
+    while (spawned < request->count)
+    {
+        void *arg = request->args == NULL ? NULL : request->args[spawned];
+        int pid = spawn_child(request->name, request->func, arg, request->stack_size, request->priority,
+                              request->detached);
+        if (pid < 0)
+            break;
 
-static Semaphore semaphores[MAXSEMS];
-static int process_mailboxes[MAXPROC];
-static ProcessData process_data[MAXPROC];
+        request->pids[spawned++] = pid;
+    }
 
-// Helpers
+    for (int i = spawned; i < request->count; i++)
+        request->pids[i] = -1;
 
-// Retrieves the given semaphore's mutex lock
-void gain_semaphore_lock(Semaphore *semaphore)
-{
-    MboxSend(semaphore->mutex_mailbox, NULL, 0);
+    args->arg1 = (void *)(long)spawned;
+    args->arg4 = 0;
 }
 
-// Releases the given semaphore's mutex lock
-void release_semaphore_lock(Semaphore *semaphore)
+// Body of every pool worker, running in user mode for its whole life
+// Asks the kernel for a task, runs it, and comes back for the next one instead of terminating
+int worker_main(void *arg)
 {
-    MboxRecv(semaphore->mutex_mailbox, NULL, 0);
-}
+    USLOSS_Sysargs args;
 
-// Called by the trampoline - waits until Spawn releases the lock before waking up
-void gain_process_lock()
-{
-    int mbox = process_mailboxes[getpid() % MAXPROC];
-    MboxRecv(mbox, NULL, 0);
-}
+    while (1)
+    {
+        memset(&args, 0, sizeof(args));
+        args.number = SYS_SUBMITWORK;
+        args.arg3 = (void *)(long)WORK_FETCH;
+        USLOSS_Syscall(&args);
 
-// Called by Spawn - wakes up the trampoline function after Spawn's work is done
-// Uses CondSend since otherwise it would block (due to the zero slot mailboxes being used)
-void release_process_lock(int pid)
-{
-    int mbox = process_mailboxes[pid % MAXPROC];
-    MboxCondSend(mbox, NULL, 0);
-}
+        int (*func)(void *) = args.arg1;
+        func(args.arg2); // Return values of pool tasks are discarded
+    }
 
-// Blocks the current process until a resource is available in the Semaphore
-// MboxSend adds process to producer queue
-void wait_resource(Semaphore *semaphore)
-{
-    MboxSend(semaphore->waiting_mailbox, NULL, 0);
+    return 0; // Never reached
 }
 
-// Frees a resource in the Semaphore
-// MboxRecv removes a process from the producer queue if there is one
-void free_resource(Semaphore *semaphore)
+// Queues a task for the worker pool, returning 0 or -1 if it can't be run
+// Wakes an idle worker if there is one, otherwise grows the pool by one detached worker
+int submit_work(int (*func)(void *), void *arg)
 {
-    MboxRecv(semaphore->waiting_mailbox, NULL, 0);
-}
+    unsigned int old_psr = disable_interrupts();
 
-// Semaphore syscall handlers
+    WorkItem *item = free_work_items;
+    if (item == NULL)
+    {
+        restore_interrupts(old_psr);
+        return -1;
+    }
 
-// Creates a new Semaphore with given arguments
-void semaphore_create(USLOSS_Sysargs *args)
-{
-    int value = (int)(long)args->arg1;
+    free_work_items = item->next;
+    item->func = func;
+    item->arg = arg;
+    item->next = NULL;
+    if (work_tail == NULL)
+        work_head = item;
+    else
+        work_tail->next = item;
+    work_tail = item;
 
-    if (value < 0) // Invalid starting value
+    if (num_idle_workers > 0)
     {
-        args->arg1 = 0;
-        args->arg4 = (void *)-1;
+        unblockProc(idle_workers[--num_idle_workers]);
     }
-    else
+    else if (num_workers < WORKER_POOL_MAX)
     {
-        // Search for the first empty semaphore
-        Semaphore *target = NULL;
-        int sid;
-        for (sid = 0; sid < MAXSEMS; sid++)
+        // Workers are detached children of whoever created them, so nobody has to Wait for them
+        num_workers++;
+        restore_interrupts(old_psr);
+        int pid = spawn_child("phase3_worker", worker_main, NULL, SUBMITWORK_STACK_SIZE, SUBMITWORK_PRIORITY, 1);
+        old_psr = disable_interrupts();
+
+        if (pid < 0)
         {
-            if (!semaphores[sid].in_use)
+            num_workers--;
+
+            // With no worker at all, nobody would ever run the task, so take it back
+            // The only queued task is ours, since earlier ones would have created a worker too
+            if (num_workers == 0)
             {
-                target = &semaphores[sid];
-                break;
+                work_head = work_tail = NULL;
+                item->next = free_work_items;
+                free_work_items = item;
+                restore_interrupts(old_psr);
+                return -1;
             }
         }
+    }
+
+    restore_interrupts(old_psr);
+    return 0;
+}
+
+// Takes the next task off the work queue for the current pool worker, blocking while there is none
+// Once the worker's parent is terminating, the worker terminates too as soon as the queue is empty,
+// since the parent can't quit before it
+void fetch_work(int (**func)(void *), void **arg)
+{
+    ProcessData *self = &process_data[getpid() % MAXPROC];
+    unsigned int old_psr = disable_interrupts();
+
+    while (work_head == NULL)
+    {
+        if (self->parent->terminating)
+            terminate_current(0, 0);
+
+        idle_workers[num_idle_workers++] = getpid();
+        blockMe();
+
+        // A TerminateTree above us takes us off the idle list before waking us
+        check_killed();
+    }
+
+    WorkItem *item = work_head;
+    work_head = item->next;
+    if (work_head == NULL)
+        work_tail = NULL;
+
+    *func = item->func;
+    *arg = item->arg;
 
-        if (target == NULL) // No free semaphores
+    item->next = free_work_items;
+    free_work_items = item;
+
+    restore_interrupts(old_psr);
+}
+
+// Wakes the idle pool workers that belong to the current process, which is terminating, so that they terminate too
+// Must be called with interrupts disabled
+void release_workers()
+{
+    int pid = getpid();
+    int woken[WORKER_POOL_MAX];
+    int num_woken = 0;
+
+    for (int i = 0; i < num_idle_workers; )
+    {
+        if (process_data[idle_workers[i] % MAXPROC].parent->pid == pid)
         {
-            args->arg1 = 0;
-            args->arg4 = (void *)-1;
+            woken[num_woken++] = idle_workers[i];
+            idle_workers[i] = idle_workers[--num_idle_workers];
         }
-        else // Initialize semaphore
+        else
         {
-            target->in_use = 1;
-            target->value = value;
+            i++;
+        }
+    }
 
-            target->mutex_mailbox = MboxCreate(1, 0);
-            target->waiting_mailbox = MboxCreate(value, 0);
+    for (int i = 0; i < num_woken; i++)
+        unblockProc(woken[i]);
+}
 
-            target->num_waiting = 0;
+// Starts a new pool worker if tasks are queued but a task that called Terminate took the last worker down with it
+// Must be called with interrupts disabled
+void replace_lost_worker()
+{
+    if (work_head == NULL || num_idle_workers > 0 || num_workers > 0)
+        return;
 
-            args->arg1 = (void *)(long)sid;
-            args->arg4 = 0;
-        }
-    }
+    // If it can't be created now, the next SubmitWork tries again
+    num_workers++;
+    if (spawn_child("phase3_worker", worker_main, NULL, SUBMITWORK_STACK_SIZE, SUBMITWORK_PRIORITY, 1) < 0)
+        num_workers--;
 }
 
-// Performs the Semaphore V operation
-void semaphore_v(USLOSS_Sysargs *args)
+// Handles the submit_work syscall, both SubmitWork and a pool worker fetching its next task
+void submit_work_handler(USLOSS_Sysargs *args)
 {
-    int sid = (int)(long)args->arg1;
-    Semaphore *semaphore = &semaphores[sid];
+    if ((long)args->arg3 == WORK_FETCH)
+    {
+        // Only pool workers may fetch, since a task taken by anyone else would never run
+        if (process_data[getpid() % MAXPROC].user_func != worker_main)
+        {
+            args->arg4 = (void *)-1;
+            return;
+        }
 
-    // Gain the semaphore's mutex lock prior to modifying the semaphore value
-    gain_semaphore_lock(semaphore);
+        int (*func)(void *);
+        void *arg;
+        fetch_work(&func, &arg);
 
-    // Release a semaphore resource (increment the value)
-    semaphore->value++;
+        args->arg1 = func;
+        args->arg2 = arg;
+        args->arg4 = 0;
+        return;
+    }
 
-    // If any processes were blocked & waiting, then free one
-    if (semaphore->num_waiting > 0)
-        free_resource(semaphore);
+    if (args->arg1 == NULL)
+    {
+        args->arg4 = (void *)-1;
+        return;
+    }
 
-    // Release the semaphore's mutex lock
-    release_semaphore_lock(semaphore);
+    args->arg4 = (void *)(long)submit_work(args->arg1, args->arg2);
 }
 
-// Performs the Semaphore P operation
-void semaphore_p(USLOSS_Sysargs *args)
+// Joins one child, unlinks it from our child list and clears its process data slot
+// Returns the child's PID, or -2 if there are no children left to join; detached says whether it was detached
+// Must be called with interrupts disabled, so that the slot can't be reused before it is cleared
+int reap_child(int *status, int *detached)
 {
-    int sid = (int)(long)args->arg1;
-    Semaphore *semaphore = &semaphores[sid];
+    int pid = join(status);
+    if (pid < 0)
+        return pid;
 
-    // Gain the semaphore's mutex lock prior to modifying the semaphore value
-    gain_semaphore_lock(semaphore);
+    ProcessData *self = &process_data[getpid() % MAXPROC];
+    ProcessData *child = &process_data[pid % MAXPROC];
+    int was_worker = child->user_func == worker_main;
 
-    int did_block = 0;
+    *detached = child->detached;
 
-    // If no resources, initiate the blocking sequence
-    if (semaphore->value <= 0)
+    ProcessData **link = child->detached ? &self->detached_children : &self->children;
+    while (*link != NULL && *link != child)
+        link = &(*link)->next_sibling;
+    if (*link != NULL)
     {
-        // Update flags while holding the global semaphore mutex lock
-        semaphore->num_waiting++;
-        did_block = 1;
+        *link = child->next_sibling;
+        if (child->detached)
+            self->num_detached--;
+        else
+            self->num_children--;
+    }
 
-        // Release the mutex to avoid deadlock
-        release_semaphore_lock(semaphore);
+    if (child->exited)
+    {
+        if (child->detached)
+            self->num_detached_exited--;
+        else
+            self->num_exited--;
+    }
 
-        // Block the current process, waiting for a semaphore resource to become available
-        wait_resource(semaphore);
+    memset(child, 0, sizeof(ProcessData));
 
-        // Regain the global semaphore mutex lock after returning, prior to modifying the semaphore value
-        gain_semaphore_lock(semaphore);
-    }
+    if (was_worker)
+        replace_lost_worker();
 
-    // At this point, semaphore resource is available, so decrement the value and release the global mutex
-    semaphore->value--;
-    if (did_block)
-        semaphore->num_waiting--; // If it did block, then remove from the blocked counter
-    release_semaphore_lock(semaphore);
+    return pid;
 }
 
-// System call handlers
-
-// Trampoline function that handles calling the user mode process
-void user_process_wrapper()
+// Joins every detached child of the current process that has already terminated, freeing their slots
+// This runs whenever the parent passes through Spawn, Wait, Terminate or a clock interrupt in user mode, so a
+// detached child's slot stays taken only while its parent is blocked somewhere else
+// join() takes whichever terminated child it finds first, so a regular child may come up too; it's kept for a Wait
+// Must be called with interrupts disabled
+void reap_detached()
 {
-    // Block (wait to gain lock) here until the parent Spawn syscall that sporked this wrapper is finished
-    gain_process_lock();
+    ProcessData *self = &process_data[getpid() % MAXPROC];
 
-    // Enable user mode
-    USLOSS_PsrSet(USLOSS_PsrGet() & ~0x1);
+    while (self->num_detached_exited > 0)
+    {
+        int status, detached;
+        int pid = reap_child(&status, &detached);
+        if (pid < 0)
+            break;
 
-    // Call user mode function
-    ProcessData *data = &process_data[getpid() % MAXPROC];
-    int status = data->user_func(data->user_arg);
+        if (!detached)
+        {
+            ExitRecord *record = &self->reaped[self->num_reaped++];
+            record->pid = pid;
+            record->status = status;
+        }
+    }
+}
 
-    // Terminate if the above function returns
-    Terminate(status);
+// Finds a spawned child of the current process that hasn't been joined yet
+ProcessData *find_child(int pid)
+{
+    ProcessData *self = &process_data[getpid() % MAXPROC];
+    for (ProcessData *child = self->children; child != NULL; child = child->next_sibling)
+    {
+        if (child->pid == pid)
+            return child;
+    }
+    return NULL;
 }
 
-// Handles the spawn syscall
-void spawn_handler(USLOSS_Sysargs *args)
+// Takes the status of an already-joined child out of the reaped table; pid -1 matches the oldest one
+// Returns 1 if one was found
+int take_reaped(int pid, int *found_pid, int *status)
 {
-    // Spork process using the trampoline function instead
-    int pid = spork(args->arg5, (int (*)(void *))user_process_wrapper, NULL, (long)args->arg3, (long)args->arg4);
+    ProcessData *self = &process_data[getpid() % MAXPROC];
 
-    // Store the necessary data the trampoline function will need
-    ProcessData *data = &process_data[pid % MAXPROC];
-    memset(data, 0, sizeof(ProcessData));
-    data->user_func = args->arg1;
-    data->user_arg = args->arg2;
+    for (int i = 0; i < self->num_reaped; i++)
+    {
+        ExitRecord *record = &self->reaped[i];
+        if (pid == -1 || record->pid == pid)
+        {
+            *found_pid = record->pid;
+            *status = record->status;
+            self->num_reaped--;
+            memmove(record, record + 1, sizeof(ExitRecord) * (self->num_reaped - i));
+            return 1;
+        }
+    }
+    return 0;
+}
 
-    // Return args
-    if (pid == -1) // Error creating child
+// Waits for a specific child (or any child, if pid is -1), optionally without blocking
+// Children joined along the way that weren't asked for are kept in the reaped table for a later Wait
+// Returns 0 and fills in found_pid/status, WAIT_NOT_READY, -1 if pid isn't our child, or -2 if we have no children
+// Must be called with interrupts disabled
+int wait_for_child(int pid, int flags, int *found_pid, int *status)
+{
+    ProcessData *self = &process_data[getpid() % MAXPROC];
+
+    reap_detached();
+
+    if (take_reaped(pid, found_pid, status))
+        return 0;
+
+    ProcessData *target = NULL;
+    if (pid == -1)
     {
-        args->arg1 = (void *)-1;
-        args->arg4 = 0;
+        if (self->children == NULL)
+            return -2;
     }
     else
     {
-        args->arg1 = (void *)(long)pid;
-        args->arg4 = 0;
+        target = find_child(pid);
+        if (target == NULL)
+            return -1;
     }
 
-    // Allow trampoline function to wake up before the syscall handler returns, since the syscall has finished its work
-    release_process_lock(pid);
+    // Only join when it can't block, unless the caller is willing to
+    if (flags & WAIT_NOHANG)
+    {
+        int ready = target == NULL ? self->num_exited > 0 : target->exited;
+        if (!ready)
+            return WAIT_NOT_READY;
+    }
+
+    while (1)
+    {
+        int child_status, detached;
+        int child_pid = reap_child(&child_status, &detached);
+        if (child_pid < 0)
+            return -2;
+
+        // A detached child's status isn't for anyone
+        if (detached)
+            continue;
+
+        if (pid == -1 || child_pid == pid)
+        {
+            *found_pid = child_pid;
+            *status = child_status;
+            return 0;
+        }
+
+        ExitRecord *record = &self->reaped[self->num_reaped++];
+        record->pid = child_pid;
+        record->status = child_status;
+    }
 }
 
 // Handles the wait syscall
 void wait_handler(USLOSS_Sysargs *args)
 {
-    // Call join
-    int status = 0;
-    int pid = join(&status);
+    int pid, status;
+
+    unsigned int old_psr = disable_interrupts();
+    int rc = wait_for_child(-1, 0, &pid, &status);
+    restore_interrupts(old_psr);
+
+    check_killed();
 
-    if (pid == -2) // No children
+    if (rc == -2) // No children
     {
         args->arg4 = (void *)-2;
     }
@@ -241,20 +1664,170 @@ void wait_handler(USLOSS_Sysargs *args)
     }
 }
 
-// Handles the terminate syscall
-void terminate_handler(USLOSS_Sysargs *args)
+// Handles the waitpid syscall
+void waitpid_handler(USLOSS_Sysargs *args)
 {
-    int status = (int)(long)args->arg1;
+    int pid = (int)(long)args->arg1;
+    int flags = (int)(long)args->arg3;
+    int found_pid = 0, status = 0;
 
-    int pid;
-    while (join(&pid) != -2)
+    unsigned int old_psr = disable_interrupts();
+    int rc = wait_for_child(pid, flags, &found_pid, &status);
+    restore_interrupts(old_psr);
+
+    check_killed();
+
+    args->arg1 = (void *)(long)found_pid;
+    args->arg2 = (void *)(long)status;
+    args->arg4 = (void *)(long)rc;
+}
+
+// Handles the wait_all syscall, collecting every child that has already terminated in one call
+// Only blocks if no child has terminated yet; arg1 returns how many statuses were filled in
+void wait_all_handler(USLOSS_Sysargs *args)
+{
+    int *pids = args->arg1;
+    int *statuses = args->arg2;
+    int max = (int)(long)args->arg3;
+
+    if (pids == NULL || statuses == NULL || max < 1)
+    {
+        args->arg1 = 0;
+        args->arg4 = (void *)-1;
+        return;
+    }
+
+    unsigned int old_psr = disable_interrupts();
+
+    // The first one may block; after that, only take children that are already done
+    int count = 0;
+    int rc = wait_for_child(-1, 0, &pids[0], &statuses[0]);
+    if (rc == 0)
+    {
+        count = 1;
+        while (count < max && wait_for_child(-1, WAIT_NOHANG, &pids[count], &statuses[count]) == 0)
+            count++;
+    }
+
+    restore_interrupts(old_psr);
+
+    check_killed();
+
+    args->arg1 = (void *)(long)count;
+    args->arg4 = (void *)(long)rc;
+}
+
+// Takes a pool worker off the idle list, returning 1 if it was there
+// Must be called with interrupts disabled
+int take_idle_worker(int pid)
+{
+    for (int i = 0; i < num_idle_workers; i++)
+    {
+        if (idle_workers[i] == pid)
+        {
+            idle_workers[i] = idle_workers[--num_idle_workers];
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Marks one descendant as killed and wakes it if it's blocked, then does the same for its own descendants
+// Must be called with interrupts disabled
+void kill_descendant(ProcessData *child)
+{
+    if (child->exited || child->killed)
+        return;
+
+    child->killed = 1;
+
+    // A child that hasn't started yet, or is running or runnable, stops at its next kernel boundary
+    // A child blocked in Wait, WaitPid, WaitAll or Terminate is woken by its own children terminating
+    if (child->waiting_on != NULL)
     {
-        // Wait for all child processes to terminate
+        Semaphore *semaphore = child->waiting_on;
+        remove_waiter(child, WAKE_KILLED);
+        wake_waiters(semaphore);
+        unblockProc(child->pid);
     }
+    else if (take_idle_worker(child->pid))
+    {
+        unblockProc(child->pid);
+    }
+
+    kill_descendants(child);
+}
+
+// Marks every descendant of the given process as killed, detached ones included, and wakes the blocked ones
+// Each of them then terminates on its own, reaping its own children, so a whole tree goes down in one round
+// Phase 3 has no other way to block in the kernel; a phase 4 wait (Sleep, a terminal or disk syscall) can't be
+// interrupted from here, so a descendant in one only terminates once it completes, and the TerminateTree waits for it
+// Must be called with interrupts disabled
+void kill_descendants(ProcessData *parent)
+{
+    for (ProcessData *child = parent->children; child != NULL; child = child->next_sibling)
+        kill_descendant(child);
+
+    for (ProcessData *child = parent->detached_children; child != NULL; child = child->next_sibling)
+        kill_descendant(child);
+}
+
+// Terminates the current process if an ancestor's TerminateTree is tearing it down
+// Its own teardown is a TerminateTree too, in case it managed to Spawn after it was marked
+void check_killed()
+{
+    if (process_data[getpid() % MAXPROC].killed)
+        terminate_current(TERM_KILLED, TERM_TREE);
+}
+
+// Terminates the current process: waits for and reaps all of its children, then quits
+// With TERM_TREE, every descendant is torn down first instead of being left to finish on its own
+void terminate_current(int status, int flags)
+{
+    ProcessData *self = &process_data[getpid() % MAXPROC];
+
+    disable_interrupts();
+
+    self->terminating = 1;
+    if (flags & TERM_TREE)
+        kill_descendants(self);
+
+    // Our idle pool workers won't be getting any more tasks from us, so let them go
+    release_workers();
+
+    int child_status, detached;
+    while (reap_child(&child_status, &detached) != -2)
+    {
+        // Wait for all child processes to terminate, detached ones included, since quit() can't leave any behind
+    }
+
+    // Discard statuses that were never reported, since nobody can ask for them any more
+    self->num_reaped = 0;
+
+    // Let our parent know that joining us won't block
+    // Interrupts stay disabled into quit(), so the parent can't see the flag before we're really gone
+    self->exited = 1;
+    if (self->parent != NULL)
+    {
+        if (self->detached)
+            self->parent->num_detached_exited++;
+        else
+            self->parent->num_exited++;
+    }
+
+    // Either the pool is shrinking, or a task called Terminate; in that case whoever reaps us replaces us if need be
+    if (self->user_func == worker_main)
+        num_workers--;
 
     quit(status); // This function will never return
 }
 
+// Handles the terminate syscall
+void terminate_handler(USLOSS_Sysargs *args)
+{
+    terminate_current((int)(long)args->arg1, (int)(long)args->arg2);
+}
+
 // Handles the get_time syscall
 void get_time_handler(USLOSS_Sysargs *args)
 {
@@ -269,29 +1842,224 @@ void get_pid_handler(USLOSS_Sysargs *args)
     args->arg1 = (void *)(long)pid; // Store it in arg1 for return
 }
 
+// Syscall instrumentation
+// Only installed while enabled, so that it costs nothing at all otherwise
+
+// Returns the host's monotonic clock in nanoseconds
+long long phase3_host_ns()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long)now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+// Installed in place of every instrumented systemCallVec entry
+// Times the real handler, including any time spent blocked inside it; syscalls that never return are only counted
+void syscall_stats_entry(USLOSS_Sysargs *args)
+{
+    SyscallStat *stat = &syscall_stats[args->number];
+    void (*handler)(USLOSS_Sysargs *args) = instrumented_handlers[args->number];
+    stat->count++;
+
+    int start = currentTime();
+    long long host_start = phase3_host_ns();
+
+    handler(args);
+
+    int elapsed = currentTime() - start;
+    stat->total_time += elapsed;
+    if (elapsed > stat->max_time)
+        stat->max_time = elapsed;
+    stat->host_ns += phase3_host_ns() - host_start;
+}
+
+// Wraps every registered syscall handler with syscall_stats_entry, or unwraps them again
+// Must be called with interrupts disabled
+void set_syscall_stats(int enabled)
+{
+    if (enabled == syscall_stats_enabled)
+        return;
+
+    for (int i = 0; i < MAXSYSCALLS; i++)
+    {
+        if (enabled && systemCallVec[i] != NULL)
+        {
+            instrumented_handlers[i] = systemCallVec[i];
+            systemCallVec[i] = syscall_stats_entry;
+        }
+        else if (!enabled && systemCallVec[i] == syscall_stats_entry)
+        {
+            // Leave the saved handler in place, for a call that already got as far as syscall_stats_entry
+            systemCallVec[i] = instrumented_handlers[i];
+        }
+    }
+
+    syscall_stats_enabled = enabled;
+}
+
+// Handles the syscall_stats syscall: arg3 STATS_QUERY copies the stats for syscall arg1 into arg2,
+// and STATS_ENABLE turns instrumentation on or off as arg1 says
+void syscall_stats_handler(USLOSS_Sysargs *args)
+{
+    int number = (int)(long)args->arg1;
+
+    if ((long)args->arg3 == STATS_ENABLE)
+    {
+        unsigned int old_psr = disable_interrupts();
+        set_syscall_stats(number != 0);
+        restore_interrupts(old_psr);
+
+        args->arg4 = 0;
+        return;
+    }
+
+    if (number < 0 || number >= MAXSYSCALLS || args->arg2 == NULL)
+    {
+        args->arg4 = (void *)-1;
+        return;
+    }
+
+    unsigned int old_psr = disable_interrupts();
+    memcpy(args->arg2, &syscall_stats[number], sizeof(SyscallStat));
+    restore_interrupts(old_psr);
+
+    args->arg4 = 0;
+}
+
+// Prints the stats of every syscall that was made while instrumentation was on; prints nothing if none were
+// A process that turned instrumentation off again has already read what it wanted, so nothing is printed then either
+void phase3_dump_syscall_stats()
+{
+    int any = 0;
+
+    if (!syscall_stats_enabled)
+        return;
+
+    for (int i = 0; i < MAXSYSCALLS; i++)
+    {
+        SyscallStat *stat = &syscall_stats[i];
+        if (stat->count == 0)
+            continue;
+
+        if (!any)
+            USLOSS_Console("syscall  count  total us   max us   avg host ns\n");
+        any = 1;
+
+        USLOSS_Console("%7d %6d %9lld %8d %13lld\n", i, stat->count, stat->total_time, stat->max_time,
+                       stat->host_ns / stat->count);
+    }
+}
+
+// Handles the get_proc_info syscall, copying the accounting for process arg1 (or the caller, if -1) into arg2
+void get_proc_info_handler(USLOSS_Sysargs *args)
+{
+    int pid = (int)(long)args->arg1;
+    ProcInfo *info = args->arg2;
+
+    if (pid == -1)
+        pid = getpid();
+
+    unsigned int old_psr = disable_interrupts();
+
+    ProcessData *data = &process_data[pid % MAXPROC];
+    if (info == NULL || pid <= 0 || data->pid != pid)
+    {
+        restore_interrupts(old_psr);
+        args->arg4 = (void *)-1;
+        return;
+    }
+
+    info->pid = pid;
+    info->cpu_time = data->cpu_time;
+    info->blocked_sem = data->blocked_sem;
+    info->blocked_wait = data->blocked_wait;
+    info->blocked_io = data->blocked_io;
+    info->syscalls = data->syscalls;
+    info->context_switches = data->context_switches;
+    info->stack_size = data->stack_size;
+
+    // The running process hasn't been charged for its current turn on the CPU yet
+    account_switch();
+    if (pid == running_pid)
+        info->cpu_time += currentTime() - running_since;
+
+    restore_interrupts(old_psr);
+
+    args->arg4 = 0;
+}
+
 // Initializes stuff for phase 3
 void phase3_init()
 {
-    // Clear out arrays of semaphores, mailboxes for trampoline mutex, and process data
-    memset(semaphores, 0, sizeof(semaphores));
-    memset(process_mailboxes, 0, sizeof(process_mailboxes));
+    // Clear out arrays of semaphores and process data
+    memset(semaphore_chunks, 0, sizeof(semaphore_chunks));
+    num_semaphore_chunks = 0;
+    free_semaphores = NULL;
+    num_semaphores_in_use = 0;
+    add_semaphore_chunk(semaphores);
+
     memset(process_data, 0, sizeof(process_data));
 
     // Assign syscall handlers
     systemCallVec[SYS_SEMCREATE] = semaphore_create;
     systemCallVec[SYS_SEMV] = semaphore_v;
     systemCallVec[SYS_SEMP] = semaphore_p;
+    systemCallVec[SYS_SEMFREE] = semaphore_free;
+    systemCallVec[SYS_SEMOP] = semaphore_op;
+    systemCallVec[SYS_SEMNAME] = semaphore_name;
+    systemCallVec[SYS_SEMSTATS] = semaphore_stats;
 
     systemCallVec[SYS_SPAWN] = spawn_handler;
+    systemCallVec[SYS_SPAWNMANY] = spawn_many_handler;
     systemCallVec[SYS_WAIT] = wait_handler;
+    systemCallVec[SYS_WAITPID] = waitpid_handler;
+    systemCallVec[SYS_WAITALL] = wait_all_handler;
+    systemCallVec[SYS_SUBMITWORK] = submit_work_handler;
     systemCallVec[SYS_TERMINATE] = terminate_handler;
 
     systemCallVec[SYS_GETTIMEOFDAY] = get_time_handler;
     systemCallVec[SYS_GETPID] = get_pid_handler;
+    systemCallVec[SYS_GETPROCINFO] = get_proc_info_handler;
+    systemCallVec[SYS_SYSCALLSTATS] = syscall_stats_handler;
+
+    // Instrumentation is off unless asked for, either now through the environment or later through SyscallStatsEnable
+    memset(syscall_stats, 0, sizeof(syscall_stats));
+    memset(instrumented_handlers, 0, sizeof(instrumented_handlers));
+    syscall_stats_enabled = 0;
+    if (getenv("PHASE3_SYSCALL_STATS") != NULL)
+        set_syscall_stats(1);
+
+    // Chain in front of phase 2's clock handler, to drive SemTimedP deadlines
+    timed_waiters = NULL;
+    phase2_clock_handler = USLOSS_IntVec[USLOSS_CLOCK_INT];
+    USLOSS_IntVec[USLOSS_CLOCK_INT] = clock_handler;
+
+    // Route every interrupt through interrupt_entry, to keep the user data page and the accounting current
+    memset(&user_page, 0, sizeof(user_page));
+    running_pid = 0;
+    running_since = 0;
+    for (int i = 0; i < USLOSS_NUM_INTS; i++)
+    {
+        interrupt_handlers[i] = USLOSS_IntVec[i];
+        if (interrupt_handlers[i] != NULL)
+            USLOSS_IntVec[i] = interrupt_entry;
+    }
+
+    // Start with an empty worker pool; workers are only created once work is submitted
+    work_head = work_tail = NULL;
+    free_work_items = NULL;
+    for (int i = WORK_QUEUE_SIZE - 1; i >= 0; i--)
+    {
+        work_items[i].next = free_work_items;
+        free_work_items = &work_items[i];
+    }
+    num_idle_workers = 0;
+    num_workers = 0;
 
-    // Create the single-slot mailboxes for all processes, for the Spawn <-> trampoline wrapper interaction
-    for (int i = 0; i < MAXPROC; i++)
-        process_mailboxes[i] = MboxCreate(1, 0);
+    // Put every startup record on the free list, for the Spawn -> trampoline handoff
+    free_startup_data = NULL;
+    for (int i = MAXPROC - 1; i >= 0; i--)
+        release_startup_data(&startup_data[i]);
 }
 
 void phase3_start_service_processes()
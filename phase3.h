@@ -5,9 +5,13 @@
 #ifndef _PHASE3_H
 #define _PHASE3_H
 
+// Most semaphores in use at once; only SemCreateFlags with SEM_GROW goes past it, growing the table in chunks of this size
 #define MAXSEMS         200
 
 extern void phase3_init(void);
+extern void phase3_dump_syscall_stats(void); // Prints per-syscall counts and times, if instrumentation is still on
+extern void phase3_dump_sem_stats(void);     // Prints the most contended semaphores, if any were named
+extern long long phase3_host_ns(void);       // The host's monotonic clock in nanoseconds, for benchmarks
 
 #endif /* _PHASE3_H */
 
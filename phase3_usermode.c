@@ -45,6 +45,66 @@ int Spawn(char *name, int (*func)(void*), void *arg, int stack_size,
 
 
 
+// The child is never Wait()ed for; the kernel reaps it the next time the caller enters the kernel after it terminates
+// The caller's Terminate still waits for it, like for any other child
+// Spawn has no argument slot left for the flag, so this goes through SpawnMany's request instead
+int SpawnDetached(char *name, int (*func)(void*), void *arg, int stack_size,
+                  int priority, int *pid)
+{
+    require_user_mode(__func__);
+
+    SpawnManyArgs request;
+    request.name       = name;
+    request.func       = func;
+    request.args       = &arg;
+    request.count      = 1;
+    request.stack_size = stack_size;
+    request.priority   = priority;
+    request.pids       = pid;
+    request.detached   = 1;
+
+    USLOSS_Sysargs args;
+    memset(&args, 0, sizeof(args));
+
+    args.number = SYS_SPAWNMANY;
+    args.arg1   = &request;
+    USLOSS_Syscall(&args);
+
+    return (int)(long)args.arg4;
+}
+
+
+
+// Returns the number of children created, or -1 if the arguments were invalid
+int SpawnMany(char *name, int (*func)(void*), void **arg_list, int count,
+              int stack_size, int priority, int *pids)
+{
+    require_user_mode(__func__);
+
+    SpawnManyArgs request;
+    request.name       = name;
+    request.func       = func;
+    request.args       = arg_list;
+    request.count      = count;
+    request.stack_size = stack_size;
+    request.priority   = priority;
+    request.pids       = pids;
+    request.detached   = 0;
+
+    USLOSS_Sysargs args;
+    memset(&args, 0, sizeof(args));
+
+    args.number = SYS_SPAWNMANY;
+    args.arg1   = &request;
+    USLOSS_Syscall(&args);
+
+    if ((int)(long)args.arg4 != 0)
+        return -1;
+    return (int)(long)args.arg1;
+}
+
+
+
 int Wait(int *pid, int *status)
 {
     require_user_mode(__func__);
@@ -62,6 +122,100 @@ int Wait(int *pid, int *status)
 
 
 
+int WaitPid(int pid, int *status, int flags)
+{
+    require_user_mode(__func__);
+
+    USLOSS_Sysargs args;
+    memset(&args, 0, sizeof(args));
+
+    args.number = SYS_WAITPID;
+    args.arg1   = (void*)(long)pid;
+    args.arg3   = (void*)(long)flags;
+    USLOSS_Syscall(&args);
+
+    int rc = (int)(long)args.arg4;
+    if (rc < 0)
+        return rc;
+
+    *status = (int)(long)args.arg2;
+    return    (int)(long)args.arg1;    // 0 if WAIT_NOHANG found nothing ready
+}
+
+
+
+int WaitAll(int *pids, int *statuses, int max, int *count)
+{
+    require_user_mode(__func__);
+
+    USLOSS_Sysargs args;
+    memset(&args, 0, sizeof(args));
+
+    args.number = SYS_WAITALL;
+    args.arg1   = pids;
+    args.arg2   = statuses;
+    args.arg3   = (void*)(long)max;
+    USLOSS_Syscall(&args);
+
+    *count = (int)(long)args.arg1;
+    return   (int)(long)args.arg4;
+}
+
+
+
+int SubmitWork(int (*func)(void*), void *arg)
+{
+    require_user_mode(__func__);
+
+    USLOSS_Sysargs args;
+    memset(&args, 0, sizeof(args));
+
+    args.number = SYS_SUBMITWORK;
+    args.arg1   = func;
+    args.arg2   = arg;
+    USLOSS_Syscall(&args);
+
+    return (int)(long)args.arg4;
+}
+
+
+
+// Turns per-syscall instrumentation on or off; the counts are kept either way
+int SyscallStatsEnable(int enabled)
+{
+    require_user_mode(__func__);
+
+    USLOSS_Sysargs args;
+    memset(&args, 0, sizeof(args));
+
+    args.number = SYS_SYSCALLSTATS;
+    args.arg1   = (void*)(long)enabled;
+    args.arg3   = (void*)STATS_ENABLE;
+    USLOSS_Syscall(&args);
+
+    return (int)(long)args.arg4;
+}
+
+
+
+int SyscallStats(int number, SyscallStat *stat)
+{
+    require_user_mode(__func__);
+
+    USLOSS_Sysargs args;
+    memset(&args, 0, sizeof(args));
+
+    args.number = SYS_SYSCALLSTATS;
+    args.arg1   = (void*)(long)number;
+    args.arg2   = stat;
+    args.arg3   = (void*)STATS_QUERY;
+    USLOSS_Syscall(&args);
+
+    return (int)(long)args.arg4;
+}
+
+
+
 void Terminate(int status)
 {
     require_user_mode(__func__);
@@ -79,6 +233,25 @@ void Terminate(int status)
 
 
 
+// Unlike Terminate, children that are still running (or haven't started yet) don't get to finish
+void TerminateTree(int status)
+{
+    require_user_mode(__func__);
+
+    USLOSS_Sysargs args;
+    memset(&args, 0, sizeof(args));
+
+    args.number = SYS_TERMINATE;
+    args.arg1   = (void*)(long)status;
+    args.arg2   = (void*)TERM_TREE;
+    USLOSS_Syscall(&args);
+
+    // never returns!
+    assert(0);
+}
+
+
+
 void GetTimeofDay(int *tod)
 {
     require_user_mode(__func__);
@@ -94,10 +267,18 @@ void GetTimeofDay(int *tod)
 
 
 
+// Reads the kernel's data page when it is current, so that only the mode check is left and no trap is needed
 void GetPID(int *pid)
 {
     require_user_mode(__func__);
 
+    int page_pid = user_data_page->pid;
+    if (page_pid > 0)
+    {
+        *pid = page_pid;
+        return;
+    }
+
     USLOSS_Sysargs args;
     memset(&args, 0, sizeof(args));
 
@@ -126,6 +307,24 @@ int SemCreate(int value, int *semaphore)
 
 
 
+int SemCreateFlags(int value, int flags, int *semaphore)
+{
+    require_user_mode(__func__);
+
+    USLOSS_Sysargs args;
+    memset(&args, 0, sizeof(args));
+
+    args.number = SYS_SEMCREATE;
+    args.arg1 = (void*)(long)value;
+    args.arg2 = (void*)(long)flags;
+    USLOSS_Syscall(&args);
+
+    *semaphore = (int)(long)args.arg1;
+    return       (int)(long)args.arg4;
+}
+
+
+
 int SemP(int semaphore)
 {
     require_user_mode(__func__);
@@ -135,6 +334,7 @@ int SemP(int semaphore)
 
     args.number = SYS_SEMP;
     args.arg1 = (void*)(long)semaphore;
+    args.arg2 = (void*)1L;
     USLOSS_Syscall(&args);
 
     return (int)(long)args.arg4;
@@ -151,8 +351,138 @@ int SemV(int semaphore)
 
     args.number = SYS_SEMV;
     args.arg1 = (void*)(long)semaphore;
+    args.arg2 = (void*)1L;
+    USLOSS_Syscall(&args);
+
+    return (int)(long)args.arg4;
+}
+
+
+
+int SemPN(int semaphore, int count)
+{
+    require_user_mode(__func__);
+
+    if (count < 0)
+        return -1;
+
+    USLOSS_Sysargs args;
+    memset(&args, 0, sizeof(args));
+
+    args.number = SYS_SEMP;
+    args.arg1 = (void*)(long)semaphore;
+    args.arg2 = (void*)(long)count;
+    USLOSS_Syscall(&args);
+
+    return (int)(long)args.arg4;
+}
+
+
+
+int SemVN(int semaphore, int count)
+{
+    require_user_mode(__func__);
+
+    if (count < 0)
+        return -1;
+
+    USLOSS_Sysargs args;
+    memset(&args, 0, sizeof(args));
+
+    args.number = SYS_SEMV;
+    args.arg1 = (void*)(long)semaphore;
+    args.arg2 = (void*)(long)count;
+    USLOSS_Syscall(&args);
+
+    return (int)(long)args.arg4;
+}
+
+
+
+int SemTryP(int semaphore)
+{
+    require_user_mode(__func__);
+
+    USLOSS_Sysargs args;
+    memset(&args, 0, sizeof(args));
+
+    args.number = SYS_SEMP;
+    args.arg1 = (void*)(long)semaphore;
+    args.arg2 = (void*)1L;
+    args.arg3 = (void*)SEMP_TRY;
+    USLOSS_Syscall(&args);
+
+    return (int)(long)args.arg4;
+}
+
+
+
+int SemTimedP(int semaphore, int usec)
+{
+    require_user_mode(__func__);
+
+    USLOSS_Sysargs args;
+    memset(&args, 0, sizeof(args));
+
+    args.number = SYS_SEMP;
+    args.arg1 = (void*)(long)semaphore;
+    args.arg2 = (void*)1L;
+    args.arg3 = (void*)SEMP_TIMED;
+    args.arg5 = (void*)(long)usec;
+    USLOSS_Syscall(&args);
+
+    return (int)(long)args.arg4;
+}
+
+
+
+int SemOp(SemOpEntry *ops, int count)
+{
+    require_user_mode(__func__);
+
+    USLOSS_Sysargs args;
+    memset(&args, 0, sizeof(args));
+
+    args.number = SYS_SEMOP;
+    args.arg1 = ops;
+    args.arg2 = (void*)(long)count;
+    USLOSS_Syscall(&args);
+
+    return (int)(long)args.arg4;
+}
+
+
+
+int SemName(int semaphore, char *name)
+{
+    require_user_mode(__func__);
+
+    USLOSS_Sysargs args;
+    memset(&args, 0, sizeof(args));
+
+    args.number = SYS_SEMNAME;
+    args.arg1 = (void*)(long)semaphore;
+    args.arg2 = name;
+    USLOSS_Syscall(&args);
+
+    return (int)(long)args.arg4;
+}
+
+
+
+int SemStatsTop(SemStats *stats, int max, int *count)
+{
+    require_user_mode(__func__);
+
+    USLOSS_Sysargs args;
+    memset(&args, 0, sizeof(args));
+
+    args.number = SYS_SEMSTATS;
+    args.arg1 = stats;
+    args.arg2 = (void*)(long)max;
     USLOSS_Syscall(&args);
 
+    *count = (int)(long)args.arg1;
     return (int)(long)args.arg4;
 }
 
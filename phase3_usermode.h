@@ -5,17 +5,154 @@
 #ifndef _PHASE3_USERMODE_H
 #define _PHASE3_USERMODE_H
 
+// Phase 3 syscalls beyond the ones in usyscall.h; only numbers 43-49 are free
+#define SYS_SEMOP       43
+#define SYS_SPAWNMANY   44
+#define SYS_WAITPID     45
+#define SYS_WAITALL     46
+#define SYS_SUBMITWORK  47
+#define SYS_SYSCALLSTATS 48
+#define SYS_SEMSTATS    49
+
+// Flags for SemCreateFlags
+#define SEM_HANDOFF     0x1 // V hands units straight to the oldest waiter, and a new P queues behind any waiter
+#define SEM_PRIORITY    0x2 // Wake the highest-priority waiter first, FIFO within a priority
+#define SEM_GROW        0x4 // May be created even with MAXSEMS semaphores in use, growing the table if needed
+
+// Ways a P can wait, passed in arg3 of SYS_SEMP
+#define SEMP_BLOCK      0 // Block until the units are available
+#define SEMP_TRY        1 // Never block
+#define SEMP_TIMED      2 // Block for at most arg5 microseconds
+
+// Returned by SemP if the semaphore was freed while the caller was blocked on it
+#define SEM_ERR_FREED       -2
+// Returned by SemTryP, or a SemTimedP with a timeout of 0 or less, if it would have had to block
+#define SEM_ERR_WOULDBLOCK  -3
+// Returned by SemTimedP if the timeout expired first
+#define SEM_ERR_TIMEOUT     -4
+
+// One entry in a SemOp vector: delta > 0 is a V of that many units, delta < 0 a P
+typedef struct SemOpEntry
+{
+    int sid;
+    int delta;
+} SemOpEntry;
+
+// Maximum number of entries in a single SemOp call
+#define SEMOP_MAX       16
+
+// Every SubmitWork task runs on a pool worker with this stack size and priority, whoever submitted it
+// A task that needs a bigger stack or a different priority has to be Spawned instead
+#define SUBMITWORK_STACK_SIZE   USLOSS_MIN_STACK
+#define SUBMITWORK_PRIORITY     3
+
+// Flags for SYS_TERMINATE, passed in arg2
+#define TERM_TREE       0x1 // Tear down every descendant instead of waiting for them to finish (see TerminateTree)
+
+// Exit status of a process torn down because one of its ancestors called TerminateTree
+#define TERM_KILLED     -3
+
+// Flags for WaitPid
+#define WAIT_NOHANG     0x1 // Return 0 instead of blocking if no matching child has terminated
+
+// SpawnMany has more arguments than fit in USLOSS_Sysargs, so they're passed by pointer in arg1
+typedef struct SpawnManyArgs
+{
+    char *name;
+    int (*func)(void *);
+    void **args;        // One argument per child, or NULL for all NULL
+    int count;
+    int stack_size;
+    int priority;
+    int *pids;          // Filled in with the children's PIDs, or -1 past the last one created
+    int detached;       // Nonzero for children that are reaped without a Wait (see SpawnDetached)
+} SpawnManyArgs;
+
+// Longest semaphore name kept by SemName, including the terminating NUL
+#define SEM_NAME_MAX    16
+
+// Contention counters for one semaphore, see SemStats
+typedef struct SemStats
+{
+    int sid;
+    char name[SEM_NAME_MAX];
+    int value;
+    int p_count;            // P operations, counting each P entry of a SemOp
+    int blocked_count;      // Ps that had to block
+    int max_waiting;        // Most processes ever blocked on it at once
+    int max_blocked;        // Longest single wait, in microseconds
+    long long total_blocked; // Total time spent blocked on it, in microseconds
+} SemStats;
+
+// Ways to call SYS_SYSCALLSTATS, passed in arg3
+#define STATS_QUERY     0 // Copy out the stats for syscall arg1 into arg2
+#define STATS_ENABLE    1 // Turn instrumentation on or off, as arg1 says
+
+// Per-syscall instrumentation, see SyscallStats
+typedef struct SyscallStat
+{
+    int count;
+    long long total_time; // Simulated microseconds, from currentTime()
+    int max_time;
+    long long host_ns;    // Host nanoseconds in total
+} SyscallStat;
+
+// Per-process accounting filled in by Sys_GetProcInfo (see libuser.h); times are in microseconds
+typedef struct ProcInfo
+{
+    int pid;
+    int cpu_time;
+    int blocked_sem;      // Blocked in SemP or SemOp
+    int blocked_wait;     // Blocked in Wait, WaitPid, WaitAll or Terminate, waiting for children
+    int blocked_io;       // Blocked in a terminal, disk or Sleep syscall
+    int syscalls;
+    int context_switches; // Times the process was given the CPU
+    int stack_size;       // As given to Spawn, or 0 if the process wasn't Spawned
+} ProcInfo;
+
+// Kernel data that user mode may read without a syscall (like a vDSO page)
+// The kernel refreshes it every time it returns to user mode; pid is 0 while the page can't be trusted
+// There is no time here: it could be a whole clock tick old by the time it was read, so GetTimeofDay always traps
+typedef struct UserDataPage
+{
+    int pid; // The running process
+} UserDataPage;
+
+extern const volatile UserDataPage *const user_data_page;
+
 // Phase 3 -- User Function Prototypes
 extern int  Spawn(char *name, int (*func)(void*), void *arg, int stack_size,
                   int priority, int *pid);
+extern int  SpawnDetached(char *name, int (*func)(void*), void *arg, int stack_size,
+                          int priority, int *pid);
+extern int  SpawnMany(char *name, int (*func)(void*), void **arg_list, int count,
+                      int stack_size, int priority, int *pids);
 extern int  Wait(int *pid, int *status);
+extern int  WaitPid(int pid, int *status, int flags); // pid -1 waits for any child;
+                                                      // returns the child's pid, 0, -1 (not a child) or -2 (no children)
+extern int  WaitAll(int *pids, int *statuses, int max, int *count);
+extern int  SubmitWork(int (*func)(void*), void *arg); // runs func(arg) on a pooled process;
+                                                       // there is nothing to Wait for, and the result is discarded;
+                                                       // see SUBMITWORK_STACK_SIZE for the stack and priority it gets
+extern int  SyscallStatsEnable(int enabled);
+extern int  SyscallStats(int number, SyscallStat *stat); // copies out the stats for one syscall number
 extern void Terminate(int status) __attribute__((__noreturn__));
+extern void TerminateTree(int status) __attribute__((__noreturn__)); // like Terminate, but every descendant
+                                                                  // still running is torn down with TERM_KILLED
 extern void GetTimeofDay(int *tod);
 extern void GetPID(int *pid);
 extern int  SemCreate(int value, int *semaphore);
+extern int  SemCreateFlags(int value, int flags, int *semaphore);
 extern int  SemP(int semaphore);
 extern int  SemV(int semaphore);
-
-   // NOTE: No SemFree() call, it was removed
+extern int  SemFree(int semaphore);
+extern int  SemPN(int semaphore, int count);  // take/release count units in one syscall;
+                                              // a count of 0 does nothing, a negative count returns -1
+extern int  SemVN(int semaphore, int count);
+extern int  SemOp(SemOpEntry *ops, int count); // all-or-nothing
+extern int  SemTryP(int semaphore);
+extern int  SemTimedP(int semaphore, int usec); // usec <= 0 is the same as SemTryP
+extern int  SemName(int semaphore, char *name);
+extern int  SemStatsTop(SemStats *stats, int max, int *count); // most contended first
 
 #endif
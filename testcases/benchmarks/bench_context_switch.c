@@ -0,0 +1,72 @@
+/*
+ * Context switch cost: two processes hand the CPU back and forth through
+ * a pair of semaphores, and the host time per switch is reported.  Run it
+ * once as is and once with --fast-switch to compare the swapcontext and
+ * _setjmp/_longjmp backends; each switch also includes a SemV and a SemP.
+ */
+
+#include <usloss.h>
+#include <usyscall.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <phase3.h>
+#include <phase3_usermode.h>
+#include <stdio.h>
+
+#define ROUNDS 20000
+
+int Ping(void *);
+int Pong(void *);
+
+int ping_sem, pong_sem;
+
+
+int start3(void *arg)
+{
+    int pid, status;
+
+    USLOSS_Console("start3(): started\n");
+
+    SemCreate(0, &ping_sem);
+    SemCreate(0, &pong_sem);
+
+    long long start = phase3_host_ns();
+
+    Spawn("Ping", Ping, NULL, USLOSS_MIN_STACK, 2, &pid);
+    Spawn("Pong", Pong, NULL, USLOSS_MIN_STACK, 2, &pid);
+
+    Wait(&pid, &status);
+    Wait(&pid, &status);
+
+    long long elapsed = phase3_host_ns() - start;
+
+    // Each round switches Ping -> Pong and Pong -> Ping
+    USLOSS_Console("start3(): %d switches, %lld host ns per switch\n", 2 * ROUNDS, elapsed / (2 * ROUNDS));
+
+    USLOSS_Console("start3(): done\n");
+    Terminate(0);
+}
+
+
+int Ping(void *arg)
+{
+    for (int i = 0; i < ROUNDS; i++)
+    {
+        SemV(pong_sem);
+        SemP(ping_sem);
+    }
+
+    return 0;
+}
+
+
+int Pong(void *arg)
+{
+    for (int i = 0; i < ROUNDS; i++)
+    {
+        SemP(pong_sem);
+        SemV(ping_sem);
+    }
+
+    return 0;
+}
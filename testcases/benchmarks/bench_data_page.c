@@ -0,0 +1,69 @@
+/*
+ * Data page microbenchmark: compares GetPID, which checks the mode and then
+ * reads the kernel's user data page, against the same call made the old
+ * way, with a full syscall trap each time.  Reports calls per host second for each, and checks that
+ * both ways agree on the PID.  GetTimeofDay always traps, and is measured
+ * alongside for reference.
+ */
+
+#include <usloss.h>
+#include <usyscall.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <phase3.h>
+#include <phase3_usermode.h>
+#include <stdio.h>
+#include <string.h>
+
+#define CALLS 100000
+
+
+// What the GetPID stub used to do: a mode check, then a trap
+int trapped_call(int number)
+{
+    USLOSS_Sysargs args;
+
+    if (USLOSS_PsrGet() != USLOSS_PSR_CURRENT_INT)
+        USLOSS_Halt(1);
+
+    memset(&args, 0, sizeof(args));
+    args.number = number;
+    USLOSS_Syscall(&args);
+
+    return (int)(long)args.arg1;
+}
+
+
+void report(char *what, long long elapsed_ns)
+{
+    USLOSS_Console("start3(): %-24s %10.0f calls per host second\n", what, CALLS / (elapsed_ns / 1e9));
+}
+
+
+int start3(void *arg)
+{
+    int pid, trapped_pid, tod;
+    long long start;
+
+    USLOSS_Console("start3(): started\n");
+
+    start = phase3_host_ns();
+    for (int i = 0; i < CALLS; i++)
+        trapped_pid = trapped_call(SYS_GETPID);
+    report("GetPID with a trap:", phase3_host_ns() - start);
+
+    start = phase3_host_ns();
+    for (int i = 0; i < CALLS; i++)
+        GetPID(&pid);
+    report("GetPID from the page:", phase3_host_ns() - start);
+
+    start = phase3_host_ns();
+    for (int i = 0; i < CALLS; i++)
+        GetTimeofDay(&tod);
+    report("GetTimeofDay (trap):", phase3_host_ns() - start);
+
+    USLOSS_Console("start3(): PIDs %s (%d, %d)\n", pid == trapped_pid ? "match" : "DIFFER", pid, trapped_pid);
+
+    USLOSS_Console("start3(): done\n");
+    Terminate(0);
+}
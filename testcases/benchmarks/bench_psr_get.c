@@ -0,0 +1,34 @@
+/*
+ * PSR read throughput: calls USLOSS_PsrGet in a tight loop and reports
+ * calls per host second.  Every PsrGet disables and re-enables interrupts
+ * around the read, so this mostly measures int_off/int_on.
+ */
+
+#include <usloss.h>
+#include <usyscall.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <phase3.h>
+#include <phase3_usermode.h>
+#include <stdio.h>
+
+#define CALLS 1000000
+
+
+int start3(void *arg)
+{
+    unsigned int psr = 0;
+
+    USLOSS_Console("start3(): started\n");
+
+    long long start = phase3_host_ns();
+    for (int i = 0; i < CALLS; i++)
+        psr |= USLOSS_PsrGet();
+    long long elapsed = phase3_host_ns() - start;
+
+    USLOSS_Console("start3(): PSR 0x%x\n", psr);
+    USLOSS_Console("start3(): USLOSS_PsrGet: %.0f calls per host second\n", CALLS / (elapsed / 1e9));
+
+    USLOSS_Console("start3(): done\n");
+    Terminate(0);
+}
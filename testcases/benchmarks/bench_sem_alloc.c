@@ -0,0 +1,64 @@
+/*
+ * Semaphore allocation benchmark: creates and frees 100,000 semaphores in
+ * batches larger than MAXSEMS, so the semaphore table has to grow past its
+ * initial size (which only SEM_GROW semaphores may do).  Reports the
+ * simulated time per create and per free.
+ */
+
+#include <usloss.h>
+#include <usyscall.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <phase3.h>
+#include <phase3_usermode.h>
+#include <stdio.h>
+
+#define BATCH_SIZE  1000
+#define NUM_BATCHES 100
+
+int sems[BATCH_SIZE];
+
+
+int start3(void *arg)
+{
+    int start, end;
+    int create_time = 0, free_time = 0;
+
+    USLOSS_Console("start3(): started\n");
+
+    for (int batch = 0; batch < NUM_BATCHES; batch++)
+    {
+        GetTimeofDay(&start);
+        for (int i = 0; i < BATCH_SIZE; i++)
+        {
+            if (SemCreateFlags(i, SEM_GROW, &sems[i]) != 0)
+            {
+                USLOSS_Console("start3(): SemCreateFlags #%d of batch %d failed\n", i, batch);
+                Terminate(1);
+            }
+        }
+        GetTimeofDay(&end);
+        create_time += end - start;
+
+        GetTimeofDay(&start);
+        for (int i = 0; i < BATCH_SIZE; i++)
+        {
+            if (SemFree(sems[i]) != 0)
+            {
+                USLOSS_Console("start3(): SemFree #%d of batch %d failed\n", i, batch);
+                Terminate(1);
+            }
+        }
+        GetTimeofDay(&end);
+        free_time += end - start;
+    }
+
+    int ops = BATCH_SIZE * NUM_BATCHES;
+
+    USLOSS_Console("start3(): %d semaphores created and freed, %d live at a time (MAXSEMS = %d)\n", ops, BATCH_SIZE, MAXSEMS);
+    USLOSS_Console("start3(): SemCreate: %d us total, %.3f us per op\n", create_time, (double)create_time / ops);
+    USLOSS_Console("start3(): SemFree:   %d us total, %.3f us per op\n", free_time, (double)free_time / ops);
+
+    USLOSS_Console("start3(): done\n");
+    Terminate(0);
+}
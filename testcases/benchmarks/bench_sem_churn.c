@@ -0,0 +1,45 @@
+/*
+ * SemFree churn benchmark: runs a million SemCreate/SemFree cycles and
+ * reports the simulated time per cycle, along with the largest sid handed
+ * out, which stays small as long as freed semaphores are reused.
+ */
+
+#include <usloss.h>
+#include <usyscall.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <phase3.h>
+#include <phase3_usermode.h>
+#include <stdio.h>
+
+#define NUM_CYCLES  1000000
+
+
+int start3(void *arg)
+{
+    int sid, max_sid;
+    int start, end;
+
+    USLOSS_Console("start3(): started\n");
+
+    max_sid = 0;
+    GetTimeofDay(&start);
+    for (int i = 0; i < NUM_CYCLES; i++)
+    {
+        if (SemCreate(1, &sid) != 0)
+        {
+            USLOSS_Console("start3(): SemCreate failed on cycle %d\n", i);
+            Terminate(1);
+        }
+        if (sid > max_sid)
+            max_sid = sid;
+        SemFree(sid);
+    }
+    GetTimeofDay(&end);
+
+    USLOSS_Console("start3(): %d create/free cycles, %.3f us per cycle\n", NUM_CYCLES, (double)(end - start) / NUM_CYCLES);
+    USLOSS_Console("start3(): largest sid handed out: %d\n", max_sid);
+
+    USLOSS_Console("start3(): done\n");
+    Terminate(0);
+}
@@ -0,0 +1,103 @@
+/*
+ * Direct-handoff semaphore benchmark.  A producer passes items to two
+ * consumers through a counting semaphore, first with a default semaphore
+ * and then with a SEM_HANDOFF one.  Reports the context switches into the
+ * producer and consumers per item handed over (from Sys_GetProcInfo), and
+ * the simulated time per item, for each mode.
+ */
+
+#include <usloss.h>
+#include <usyscall.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <phase3_usermode.h>
+#include <libuser.h>
+#include <stdio.h>
+
+#define ITEMS       1000
+#define CONSUMERS   2
+
+int Producer(void *);
+int Consumer(void *);
+
+int items;
+int taken;
+
+int switches; // Context switches into the producer and consumers, added up by each as it finishes
+
+
+void run(char *label, int flags)
+{
+    int pid, status;
+    int start, end;
+
+    SemCreateFlags(0, flags, &items);
+    taken = 0;
+
+    switches = 0;
+
+    GetTimeofDay(&start);
+
+    for (long i = 1; i <= CONSUMERS; i++)
+        Spawn("Consumer", Consumer, (void *)i, USLOSS_MIN_STACK, 2, &pid);
+    Spawn("Producer", Producer, NULL, USLOSS_MIN_STACK, 2, &pid);
+
+    for (int i = 0; i < CONSUMERS + 1; i++)
+        Wait(&pid, &status);
+
+    GetTimeofDay(&end);
+
+    USLOSS_Console("start3(): %-8s %d items: %.2f switches per handoff, %.2f us per item\n",
+                   label, ITEMS, (double)switches / ITEMS, (double)(end - start) / ITEMS);
+
+    SemFree(items);
+}
+
+
+int start3(void *arg)
+{
+    USLOSS_Console("start3(): started\n");
+
+    run("default", 0);
+    run("handoff", SEM_HANDOFF);
+
+    USLOSS_Console("start3(): done\n");
+    Terminate(0);
+}
+
+
+int Producer(void *arg)
+{
+    ProcInfo info;
+
+    for (int i = 0; i < ITEMS; i++)
+        SemV(items);
+
+    // Let the consumers know that no more items are coming
+    SemVN(items, CONSUMERS);
+
+    if (Sys_GetProcInfo(-1, &info) == 0)
+        switches += info.context_switches;
+    return 0;
+}
+
+
+int Consumer(void *arg)
+{
+    ProcInfo info;
+    int consumed = 0;
+
+    // Units past the first ITEMS are the producer's end-of-stream markers, one per consumer
+    while (1)
+    {
+        SemP(items);
+
+        if (++taken > ITEMS)
+            break;
+        consumed++;
+    }
+
+    if (Sys_GetProcInfo(-1, &info) == 0)
+        switches += info.context_switches;
+    return consumed;
+}
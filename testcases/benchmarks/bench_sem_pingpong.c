@@ -0,0 +1,90 @@
+/*
+ * Semaphore ping-pong benchmark: two processes hand control back and forth
+ * through a pair of semaphores.  Reports the simulated time per round trip,
+ * and how many times the kernel gave either process the CPU per P/V pair
+ * (from Sys_GetProcInfo).  Run it before and after a change to the semaphore
+ * implementation to compare.
+ */
+
+#include <usloss.h>
+#include <usyscall.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <phase3_usermode.h>
+#include <libuser.h>
+#include <stdio.h>
+
+#define ROUNDS 1000
+
+int Ping(void *);
+int Pong(void *);
+
+int ping_sem, pong_sem;
+
+int switches; // Context switches into Ping and Pong, added up by each as it finishes
+
+
+int start3(void *arg)
+{
+    int pid, status;
+    int start, end;
+
+    USLOSS_Console("start3(): started\n");
+
+    SemCreate(0, &ping_sem);
+    SemCreate(0, &pong_sem);
+
+    switches = 0;
+
+    GetTimeofDay(&start);
+
+    Spawn("Ping", Ping, NULL, USLOSS_MIN_STACK, 2, &pid);
+    Spawn("Pong", Pong, NULL, USLOSS_MIN_STACK, 2, &pid);
+
+    Wait(&pid, &status);
+    Wait(&pid, &status);
+
+    GetTimeofDay(&end);
+
+    // Each round is two P/V pairs: Ping -> Pong and Pong -> Ping
+    int pairs = 2 * ROUNDS;
+
+    USLOSS_Console("start3(): %d rounds, %d P/V pairs\n", ROUNDS, pairs);
+    USLOSS_Console("start3(): context switches: %d (%.2f per P/V pair)\n", switches, (double)switches / pairs);
+    USLOSS_Console("start3(): simulated time: %d us (%.2f us per round)\n", end - start, (double)(end - start) / ROUNDS);
+
+    USLOSS_Console("start3(): done\n");
+    Terminate(0);
+}
+
+
+int Ping(void *arg)
+{
+    ProcInfo info;
+
+    for (int i = 0; i < ROUNDS; i++)
+    {
+        SemV(pong_sem);
+        SemP(ping_sem);
+    }
+
+    if (Sys_GetProcInfo(-1, &info) == 0)
+        switches += info.context_switches;
+    return 1;
+}
+
+
+int Pong(void *arg)
+{
+    ProcInfo info;
+
+    for (int i = 0; i < ROUNDS; i++)
+    {
+        SemP(pong_sem);
+        SemV(ping_sem);
+    }
+
+    if (Sys_GetProcInfo(-1, &info) == 0)
+        switches += info.context_switches;
+    return 2;
+}
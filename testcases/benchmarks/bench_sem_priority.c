@@ -0,0 +1,121 @@
+/*
+ * Priority-ordered wakeup benchmark.  Eight priority-4 workers queue up on a
+ * semaphore, then three priority-2 workers queue up behind them.  A
+ * priority-5 releaser then V's one unit at a fixed interval.  Reports the
+ * wakeup latency of the high-priority workers, for a FIFO semaphore and for
+ * a SEM_PRIORITY one.
+ */
+
+#include <usloss.h>
+#include <usyscall.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <phase3_usermode.h>
+#include <stdio.h>
+
+#define NUM_LOW     8
+#define NUM_HIGH    3
+#define INTERVAL_US 1000
+
+int Low(void *);
+int High(void *);
+int Releaser(void *);
+
+int semaphore;
+int release_start;
+int high_latency[NUM_HIGH];
+
+
+// Spins until the given number of simulated microseconds have passed
+void burn(int usec)
+{
+    int start, now;
+
+    GetTimeofDay(&start);
+    do
+    {
+        GetTimeofDay(&now);
+    } while (now - start < usec);
+}
+
+
+void run(char *label, int flags)
+{
+    int pid, status;
+
+    SemCreateFlags(0, flags, &semaphore);
+
+    // The low-priority workers queue up first, as soon as start3 blocks in Wait
+    for (int i = 0; i < NUM_LOW; i++)
+        Spawn("Low", Low, NULL, USLOSS_MIN_STACK, 4, &pid);
+    Spawn("Releaser", Releaser, NULL, USLOSS_MIN_STACK, 5, &pid);
+
+    for (int i = 0; i < NUM_LOW + 1; i++)
+        Wait(&pid, &status);
+
+    int max = 0, total = 0;
+    for (int i = 0; i < NUM_HIGH; i++)
+    {
+        total += high_latency[i];
+        if (high_latency[i] > max)
+            max = high_latency[i];
+    }
+
+    USLOSS_Console("start3(): %-8s high-priority wakeup latency: avg %d us, max %d us (release interval %d us)\n",
+                   label, total / NUM_HIGH, max, INTERVAL_US);
+
+    SemFree(semaphore);
+}
+
+
+int start3(void *arg)
+{
+    USLOSS_Console("start3(): started\n");
+
+    run("fifo", SEM_HANDOFF);
+    run("priority", SEM_HANDOFF | SEM_PRIORITY);
+
+    USLOSS_Console("start3(): done\n");
+    Terminate(0);
+}
+
+
+int Releaser(void *arg)
+{
+    int pid, status;
+
+    // Only runs once every Low is blocked; each High runs straight away and queues up behind them
+    for (long i = 0; i < NUM_HIGH; i++)
+        Spawn("High", High, (void *)i, USLOSS_MIN_STACK, 2, &pid);
+
+    GetTimeofDay(&release_start);
+    for (int i = 0; i < NUM_LOW + NUM_HIGH; i++)
+    {
+        burn(INTERVAL_US);
+        SemV(semaphore);
+    }
+
+    for (int i = 0; i < NUM_HIGH; i++)
+        Wait(&pid, &status);
+
+    return 0;
+}
+
+
+int Low(void *arg)
+{
+    SemP(semaphore);
+    return 0;
+}
+
+
+int High(void *arg)
+{
+    int now;
+
+    SemP(semaphore);
+    GetTimeofDay(&now);
+
+    high_latency[(long)arg] = now - release_start;
+    return 0;
+}
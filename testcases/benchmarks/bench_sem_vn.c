@@ -0,0 +1,56 @@
+/*
+ * Multi-unit semaphore benchmark.  Compares releasing a batch of N units
+ * with N separate SemV calls against a single SemVN(N), draining them with
+ * one SemPN(N) each time, and reports the simulated time per batch.
+ */
+
+#include <usloss.h>
+#include <usyscall.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <phase3_usermode.h>
+#include <stdio.h>
+
+#define BATCH       32
+#define REPEATS     1000
+
+int semaphore;
+
+
+int start3(void *arg)
+{
+    int start, end;
+    int single_time, batch_time;
+
+    USLOSS_Console("start3(): started\n");
+
+    SemCreate(0, &semaphore);
+
+    // N single V's, followed by one P(N) to drain them again
+    GetTimeofDay(&start);
+    for (int r = 0; r < REPEATS; r++)
+    {
+        for (int i = 0; i < BATCH; i++)
+            SemV(semaphore);
+        SemPN(semaphore, BATCH);
+    }
+    GetTimeofDay(&end);
+    single_time = end - start;
+
+    // One V(N), followed by the same P(N)
+    GetTimeofDay(&start);
+    for (int r = 0; r < REPEATS; r++)
+    {
+        SemVN(semaphore, BATCH);
+        SemPN(semaphore, BATCH);
+    }
+    GetTimeofDay(&end);
+    batch_time = end - start;
+
+    USLOSS_Console("start3(): releasing %d units, %d times\n", BATCH, REPEATS);
+    USLOSS_Console("start3():   %d x SemV: %.2f us per batch\n", BATCH, (double)single_time / REPEATS);
+    USLOSS_Console("start3():   1 x SemVN: %.2f us per batch\n", (double)batch_time / REPEATS);
+
+    USLOSS_Console("start3(): done\n");
+    Terminate(0);
+}
@@ -0,0 +1,70 @@
+/*
+ * SpawnMany benchmark.  Launches batches of identical workers with a loop of
+ * Spawn calls and with a single SpawnMany, and reports the simulated time per
+ * child for each.
+ */
+
+#include <usloss.h>
+#include <usyscall.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <phase3_usermode.h>
+#include <stdio.h>
+
+#define BATCH   32
+#define ROUNDS  20
+
+int Worker(void *);
+
+int pids[MAXPROC];
+void *worker_args[MAXPROC];
+
+
+void reap(int count)
+{
+    int pid, status;
+    for (int i = 0; i < count; i++)
+        Wait(&pid, &status);
+}
+
+
+int start3(void *arg)
+{
+    int start, end;
+    int loop_time = 0, batch_time = 0;
+
+    USLOSS_Console("start3(): started\n");
+
+    for (long i = 0; i < MAXPROC; i++)
+        worker_args[i] = (void *)i;
+
+    for (int r = 0; r < ROUNDS; r++)
+    {
+        GetTimeofDay(&start);
+        for (int i = 0; i < BATCH; i++)
+            Spawn("Worker", Worker, worker_args[i], USLOSS_MIN_STACK, 4, &pids[i]);
+        GetTimeofDay(&end);
+        loop_time += end - start;
+        reap(BATCH);
+
+        GetTimeofDay(&start);
+        SpawnMany("Worker", Worker, worker_args, BATCH, USLOSS_MIN_STACK, 4, pids);
+        GetTimeofDay(&end);
+        batch_time += end - start;
+        reap(BATCH);
+    }
+
+    int children = ROUNDS * BATCH;
+    USLOSS_Console("start3(): %d children in batches of %d\n", children, BATCH);
+    USLOSS_Console("start3():   Spawn loop: %.2f us per child\n", (double)loop_time / children);
+    USLOSS_Console("start3():   SpawnMany:  %.2f us per child\n", (double)batch_time / children);
+
+    USLOSS_Console("start3(): done\n");
+    Terminate(0);
+}
+
+
+int Worker(void *arg)
+{
+    return (int)(long)arg;
+}
@@ -0,0 +1,64 @@
+/*
+ * Spawn/Wait storm benchmark.  Repeatedly fills the process table with
+ * trivial children and reaps them all again, once with children that run
+ * only after the parent blocks in Wait, and once with children that preempt
+ * the parent as soon as they are spawned.  Reports the simulated time per
+ * Spawn+Wait pair.
+ */
+
+#include <usloss.h>
+#include <usyscall.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <phase3_usermode.h>
+#include <stdio.h>
+
+#define ROUNDS      20
+#define CHILDREN    (MAXPROC - 10) // Leave room for init, the testcase driver and phase 2's service processes
+
+int Child(void *);
+
+
+void storm(char *label, int priority)
+{
+    int pid, status;
+    int start, end;
+
+    GetTimeofDay(&start);
+    for (int r = 0; r < ROUNDS; r++)
+    {
+        for (int i = 0; i < CHILDREN; i++)
+        {
+            if (Spawn("Child", Child, NULL, USLOSS_MIN_STACK, priority, &pid) != 0 || pid < 0)
+            {
+                USLOSS_Console("start3(): Spawn #%d of round %d failed\n", i, r);
+                Terminate(1);
+            }
+        }
+
+        for (int i = 0; i < CHILDREN; i++)
+            Wait(&pid, &status);
+    }
+    GetTimeofDay(&end);
+
+    int pairs = ROUNDS * CHILDREN;
+    USLOSS_Console("start3(): %-10s %d Spawn+Wait pairs, %.2f us per pair\n", label, pairs, (double)(end - start) / pairs);
+}
+
+
+int start3(void *arg)
+{
+    USLOSS_Console("start3(): started\n");
+
+    storm("deferred", 4);
+    storm("immediate", 2);
+
+    USLOSS_Console("start3(): done\n");
+    Terminate(0);
+}
+
+
+int Child(void *arg)
+{
+    return 0;
+}
@@ -0,0 +1,110 @@
+/*
+ * Worker pool benchmark: runs the same batch of short tasks once with a
+ * fresh process per task (Spawn + Wait) and once through SubmitWork, for
+ * tasks that busy-wait for 1, 10 and 100 clock ticks.  Reports the total
+ * simulated time for each, and the overhead per task beyond the work
+ * itself.
+ */
+
+#include <usloss.h>
+#include <usyscall.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <phase3_usermode.h>
+#include <stdio.h>
+
+#define TASKS   5
+#define TICK_US 20000 // One clock interrupt
+
+int Task(void *);
+
+int done_sem;
+
+static int task_sizes[] = { 1, 10, 100 };
+
+#define NUM_TASK_SIZES (int)(sizeof(task_sizes) / sizeof(task_sizes[0]))
+
+
+// Runs the batch with one Spawn + Wait per task, returning the simulated time it took
+int run_spawned(int ticks)
+{
+    int pid, status;
+    int start, end;
+
+    GetTimeofDay(&start);
+    for (int i = 0; i < TASKS; i++)
+    {
+        Spawn("Task", Task, (void *)(long)ticks, USLOSS_MIN_STACK, 3, &pid);
+        Wait(&pid, &status);
+        SemP(done_sem); // Keep the count in step, since Task always reports in
+    }
+    GetTimeofDay(&end);
+
+    return end - start;
+}
+
+
+// Runs the batch through the worker pool, one task at a time, returning the simulated time it took
+int run_pooled(int ticks)
+{
+    int start, end;
+
+    GetTimeofDay(&start);
+    for (int i = 0; i < TASKS; i++)
+    {
+        if (SubmitWork(Task, (void *)(long)ticks) != 0)
+        {
+            USLOSS_Console("start3(): SubmitWork failed\n");
+            continue;
+        }
+        SemP(done_sem);
+    }
+    GetTimeofDay(&end);
+
+    return end - start;
+}
+
+
+int start3(void *arg)
+{
+    USLOSS_Console("start3(): started\n");
+
+    SemCreate(0, &done_sem);
+
+    // Warm the pool up, so that creating the worker isn't charged to the first batch
+    SubmitWork(Task, (void *)0L);
+    SemP(done_sem);
+
+    for (int i = 0; i < NUM_TASK_SIZES; i++)
+    {
+        int ticks = task_sizes[i];
+        int work = TASKS * ticks * TICK_US;
+
+        int spawned = run_spawned(ticks);
+        int pooled = run_pooled(ticks);
+
+        USLOSS_Console("start3(): %3d-tick tasks: Spawn+Wait %d us (%d us overhead per task), SubmitWork %d us (%d us overhead per task)\n",
+                       ticks, spawned, (spawned - work) / TASKS, pooled, (pooled - work) / TASKS);
+    }
+
+    USLOSS_Console("start3(): done\n");
+    Terminate(0);
+}
+
+
+// Busy-waits in user mode for the given number of clock ticks, then reports that it's done
+int Task(void *arg)
+{
+    int ticks = (int)(long)arg;
+    int start, now;
+
+    GetTimeofDay(&start);
+    do
+    {
+        GetTimeofDay(&now);
+    } while (now - start < ticks * TICK_US);
+
+    SemV(done_sem);
+    return 0;
+}
+
@@ -0,0 +1,47 @@
+/*
+ * Syscall trap cost: makes a batch of cheap syscalls (SemV, and a
+ * GetPID that always traps) and reports host nanoseconds per call.  Run
+ * it once as is and once with --fast-trap to compare the SIGUSR1 trap
+ * path against the direct one; the output is otherwise the same.
+ */
+
+#include <usloss.h>
+#include <usyscall.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <phase3.h>
+#include <phase3_usermode.h>
+#include <stdio.h>
+#include <string.h>
+
+#define CALLS 100000
+
+
+int start3(void *arg)
+{
+    USLOSS_Sysargs args;
+    int sem;
+    long long start;
+
+    USLOSS_Console("start3(): started\n");
+
+    SemCreate(0, &sem);
+
+    start = phase3_host_ns();
+    for (int i = 0; i < CALLS; i++)
+        SemV(sem);
+    USLOSS_Console("start3(): SemV: %lld host ns per call\n", (phase3_host_ns() - start) / CALLS);
+
+    // GetPID would read the data page, so trap directly
+    start = phase3_host_ns();
+    for (int i = 0; i < CALLS; i++)
+    {
+        memset(&args, 0, sizeof(args));
+        args.number = SYS_GETPID;
+        USLOSS_Syscall(&args);
+    }
+    USLOSS_Console("start3(): GetPID trap: %lld host ns per call\n", (phase3_host_ns() - start) / CALLS);
+
+    USLOSS_Console("start3(): done\n");
+    Terminate(0);
+}
@@ -0,0 +1,135 @@
+/*
+ * Cascading teardown benchmark: builds a three-level tree of 45 processes
+ * under a single Root (4 children, each with 2 children, each of those with
+ * 4 children), leaves every node blocked on a semaphore or spinning in user
+ * code, and then has Root call TerminateTree.  Reports the simulated time from
+ * Root's TerminateTree until start3's Wait returns, and the exit status Root
+ * reported.  Run it before and after a change to terminate to compare.
+ */
+
+#include <usloss.h>
+#include <usyscall.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <phase3_usermode.h>
+#include <stdio.h>
+
+#define LEVEL1_FANOUT 4
+#define LEVEL2_FANOUT 2
+#define LEVEL3_FANOUT 4
+
+#define TREE_SIZE (LEVEL1_FANOUT + LEVEL1_FANOUT * LEVEL2_FANOUT + LEVEL1_FANOUT * LEVEL2_FANOUT * LEVEL3_FANOUT)
+
+int Root(void *);
+int Level1(void *);
+int Level2(void *);
+int Level3(void *);
+
+int built_sem;   // V'ed once by every node after it has spawned its own children
+int go_sem;      // Root waits here until start3 says the tree is complete
+int parked_sem;  // Never V'ed, so whoever P's it stays blocked until torn down
+
+int nodes_created;
+int terminate_time;
+
+
+int start3(void *arg)
+{
+    int pid, status;
+    int end;
+
+    USLOSS_Console("start3(): started\n");
+
+    SemCreate(0, &built_sem);
+    SemCreate(0, &go_sem);
+    SemCreate(0, &parked_sem);
+
+    nodes_created = 0;
+
+    Spawn("Root", Root, NULL, USLOSS_MIN_STACK, 3, &pid);
+
+    // Every node reports in once it has spawned its own children; failed spawns are reported by the parent
+    for (int i = 0; i < TREE_SIZE; i++)
+        SemP(built_sem);
+
+    USLOSS_Console("start3(): tree built, %d of %d processes\n", nodes_created, TREE_SIZE);
+
+    SemV(go_sem);
+    Wait(&pid, &status);
+
+    GetTimeofDay(&end);
+
+    USLOSS_Console("start3(): Root exited with status %d\n", status);
+    USLOSS_Console("start3(): teardown of %d processes took %d us\n", nodes_created, end - terminate_time);
+
+    USLOSS_Console("start3(): done\n");
+    Terminate(0);
+}
+
+
+// Spawns count children running func, each heading a subtree of subtree_size processes
+// Spawn failures just make the tree smaller; the missing subtree is reported as built right away
+void spawn_children(char *name, int (*func)(void *), int count, int subtree_size)
+{
+    int pid;
+
+    for (int i = 0; i < count; i++)
+    {
+        if (Spawn(name, func, NULL, USLOSS_MIN_STACK, 4, &pid) == 0 && pid >= 0)
+            nodes_created++;
+        else
+            SemVN(built_sem, subtree_size);
+    }
+}
+
+
+int Root(void *arg)
+{
+    spawn_children("Level1", Level1, LEVEL1_FANOUT, 1 + LEVEL2_FANOUT + LEVEL2_FANOUT * LEVEL3_FANOUT);
+
+    SemP(go_sem);
+
+    GetTimeofDay(&terminate_time);
+    TerminateTree(7);
+    return 0;
+}
+
+
+int Level1(void *arg)
+{
+    spawn_children("Level2", Level2, LEVEL2_FANOUT, 1 + LEVEL3_FANOUT);
+    SemV(built_sem);
+
+    SemP(parked_sem);
+    return 1;
+}
+
+
+int Level2(void *arg)
+{
+    spawn_children("Level3", Level3, LEVEL3_FANOUT, 1);
+    SemV(built_sem);
+
+    // Blocked in Wait rather than on a semaphore
+    int pid, status;
+    Wait(&pid, &status);
+    return 2;
+}
+
+
+int Level3(void *arg)
+{
+    SemV(built_sem);
+
+    // Half the leaves block, the other half keep running in user mode
+    int pid;
+    GetPID(&pid);
+    if (pid % 2 == 0)
+        SemP(parked_sem);
+    else
+        while (1)
+        {
+        }
+
+    return 3;
+}
@@ -0,0 +1,75 @@
+/*
+ * WaitAll benchmark.  Fans out 45 children that finish straight away, then
+ * collects them with a loop of Wait calls and with WaitAll.  Reports the
+ * simulated completion time of each, and how many WaitAll calls were needed.
+ */
+
+#include <usloss.h>
+#include <usyscall.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <phase3_usermode.h>
+#include <stdio.h>
+
+#define NUM_CHILDREN 45
+
+int Child(void *);
+
+int pids[NUM_CHILDREN];
+int statuses[NUM_CHILDREN];
+
+
+// The children preempt us, so they have all terminated by the time this returns
+void fan_out()
+{
+    int pid;
+    for (long i = 0; i < NUM_CHILDREN; i++)
+    {
+        if (Spawn("Child", Child, (void *)i, USLOSS_MIN_STACK, 2, &pid) != 0 || pid < 0)
+        {
+            USLOSS_Console("start3(): Spawn #%ld failed\n", i);
+            Terminate(1);
+        }
+    }
+}
+
+
+int start3(void *arg)
+{
+    int start, end;
+    int pid, status, count;
+
+    USLOSS_Console("start3(): started\n");
+
+    GetTimeofDay(&start);
+    fan_out();
+    for (int i = 0; i < NUM_CHILDREN; i++)
+        Wait(&pid, &status);
+    GetTimeofDay(&end);
+    USLOSS_Console("start3(): Wait loop: %d children in %d us\n", NUM_CHILDREN, end - start);
+
+    GetTimeofDay(&start);
+    fan_out();
+    int calls = 0, total = 0, sum = 0;
+    while (total < NUM_CHILDREN && WaitAll(pids, statuses, NUM_CHILDREN, &count) == 0)
+    {
+        calls++;
+        total += count;
+        for (int i = 0; i < count; i++)
+            sum += statuses[i];
+    }
+    GetTimeofDay(&end);
+    USLOSS_Console("start3(): WaitAll:   %d children in %d us, %d call(s)\n", total, end - start, calls);
+    USLOSS_Console("start3(): sum of statuses %d (expected %d)\n", sum, NUM_CHILDREN * (NUM_CHILDREN - 1) / 2);
+
+    USLOSS_Console("start3(): WaitAll with no children returned %d\n", WaitAll(pids, statuses, NUM_CHILDREN, &count));
+
+    USLOSS_Console("start3(): done\n");
+    Terminate(0);
+}
+
+
+int Child(void *arg)
+{
+    return (int)(long)arg;
+}
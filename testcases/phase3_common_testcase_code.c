@@ -87,6 +87,8 @@ void phase5_start_service_processes()
 void finish(int argc, char **argv)
 {
     USLOSS_Console("%s(): The simulation is now terminating.\n", __func__);
+    phase3_dump_syscall_stats();
+    phase3_dump_sem_stats();
 }
 
 void test_setup  (int argc, char **argv) {}
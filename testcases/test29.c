@@ -0,0 +1,64 @@
+/*
+ * Semaphore allocation stress test: creates and frees 100,000 semaphores in
+ * batches larger than MAXSEMS, so the semaphore table has to grow past its
+ * initial size (which only SEM_GROW semaphores may do).  Checks that a
+ * plain SemCreate still fails while the table is that full, and that freed
+ * semaphores can't be used.  The timing version is
+ * benchmarks/bench_sem_alloc.c.
+ */
+
+#include <usloss.h>
+#include <usyscall.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <phase3.h>
+#include <phase3_usermode.h>
+#include <stdio.h>
+
+#define BATCH_SIZE  1000
+#define NUM_BATCHES 100
+
+int sems[BATCH_SIZE];
+
+
+int start3(void *arg)
+{
+    int plain_sem;
+
+    USLOSS_Console("start3(): started\n");
+
+    for (int batch = 0; batch < NUM_BATCHES; batch++)
+    {
+        for (int i = 0; i < BATCH_SIZE; i++)
+        {
+            if (SemCreateFlags(i, SEM_GROW, &sems[i]) != 0)
+            {
+                USLOSS_Console("start3(): SemCreateFlags #%d of batch %d failed\n", i, batch);
+                Terminate(1);
+            }
+        }
+
+        // Only SEM_GROW may go past MAXSEMS
+        if (batch == 0)
+            USLOSS_Console("start3(): SemCreate with %d semaphores in use returned %d\n", BATCH_SIZE, SemCreate(0, &plain_sem));
+
+        for (int i = 0; i < BATCH_SIZE; i++)
+        {
+            if (SemFree(sems[i]) != 0)
+            {
+                USLOSS_Console("start3(): SemFree #%d of batch %d failed\n", i, batch);
+                Terminate(1);
+            }
+        }
+    }
+
+    int ops = BATCH_SIZE * NUM_BATCHES;
+
+    USLOSS_Console("start3(): %d semaphores created and freed, %d live at a time (MAXSEMS = %d)\n", ops, BATCH_SIZE, MAXSEMS);
+
+    // Freed semaphores must no longer be usable
+    USLOSS_Console("start3(): SemV on a freed semaphore returned %d\n", SemV(sems[0]));
+
+    USLOSS_Console("start3(): done\n");
+    Terminate(0);
+}
@@ -0,0 +1,104 @@
+/*
+ * SemFree churn test.  First checks that freeing a semaphore wakes every
+ * process blocked on it with SEM_ERR_FREED, including one that a V has
+ * already woken but that hasn't run yet, even once its sid has been handed
+ * out again.  Then runs a million create/free cycles, and checks that the
+ * semaphore table never grows (the same sids keep getting reused) and that
+ * a full table of MAXSEMS semaphores can still be created afterwards.  The
+ * timing version of the churn is benchmarks/bench_sem_churn.c.
+ */
+
+#include <usloss.h>
+#include <usyscall.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <phase3.h>
+#include <phase3_usermode.h>
+#include <stdio.h>
+
+#define NUM_WAITERS 3
+#define NUM_CYCLES  1000000
+
+int Waiter(void *);
+
+int semaphore;
+
+
+int start3(void *arg)
+{
+    int pid, status;
+    int sid, max_sid;
+
+    USLOSS_Console("start3(): started\n");
+
+    // Free a semaphore with blocked waiters
+    SemCreate(0, &semaphore);
+    for (int i = 0; i < NUM_WAITERS; i++)
+        Spawn("Waiter", Waiter, NULL, USLOSS_MIN_STACK, 2, &pid);
+
+    USLOSS_Console("start3(): SemFree with %d waiters returned %d\n", NUM_WAITERS, SemFree(semaphore));
+
+    for (int i = 0; i < NUM_WAITERS; i++)
+    {
+        Wait(&pid, &status);
+        USLOSS_Console("start3(): Waiter exited with status %d\n", status);
+    }
+
+    USLOSS_Console("start3(): SemFree on a freed semaphore returned %d\n", SemFree(semaphore));
+
+    // Free a semaphore whose only waiter was woken by a V but hasn't run yet, then reuse its sid
+    // The waiter is below us, so it only gets to block while we sleep on a SemTimedP, and doesn't run after the V
+    int old_sid, sleeper;
+    SemCreate(0, &semaphore);
+    SemCreate(0, &sleeper);
+    old_sid = semaphore;
+    Spawn("Waiter", Waiter, NULL, USLOSS_MIN_STACK, 4, &pid);
+    SemTimedP(sleeper, 100000);
+    SemV(semaphore);
+    USLOSS_Console("start3(): SemFree with a woken waiter returned %d\n", SemFree(semaphore));
+    SemCreate(0, &semaphore);
+    USLOSS_Console("start3(): sid %s\n", semaphore == old_sid ? "reused" : "NOT reused");
+    Wait(&pid, &status);
+    USLOSS_Console("start3(): Waiter exited with status %d\n", status);
+    USLOSS_Console("start3(): SemTryP on the new semaphore returned %d\n", SemTryP(semaphore));
+    SemFree(semaphore);
+    SemFree(sleeper);
+
+    // Churn through create/free cycles, tracking the largest sid handed out
+    max_sid = 0;
+    for (int i = 0; i < NUM_CYCLES; i++)
+    {
+        if (SemCreate(1, &sid) != 0)
+        {
+            USLOSS_Console("start3(): SemCreate failed on cycle %d\n", i);
+            Terminate(1);
+        }
+        if (sid > max_sid)
+            max_sid = sid;
+        SemFree(sid);
+    }
+
+    USLOSS_Console("start3(): %d create/free cycles\n", NUM_CYCLES);
+    USLOSS_Console("start3(): largest sid handed out: %d (table %s)\n", max_sid, max_sid < MAXSEMS ? "did not grow" : "GREW");
+
+    // Nothing should have leaked, so the whole initial table is still available
+    for (int i = 0; i < MAXSEMS; i++)
+    {
+        if (SemCreate(0, &sid) != 0)
+        {
+            USLOSS_Console("start3(): SemCreate #%d after churn failed\n", i);
+            Terminate(1);
+        }
+    }
+    USLOSS_Console("start3(): created %d semaphores after churn\n", MAXSEMS);
+
+    USLOSS_Console("start3(): done\n");
+    Terminate(0);
+}
+
+
+int Waiter(void *arg)
+{
+    int rc = SemP(semaphore);
+    return rc == SEM_ERR_FREED ? 1 : 0;
+}
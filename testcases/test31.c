@@ -0,0 +1,67 @@
+/*
+ * Large-value semaphore test: creates semaphores with initial values up to
+ * INT_MAX/2 alongside many small ones.  A semaphore's footprint must not
+ * depend on its value, so none of these creations may fail.  Also checks
+ * that P and V still work on the large semaphores, and that a V which would
+ * overflow the counter is rejected.
+ */
+
+#include <usloss.h>
+#include <usyscall.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <phase3.h>
+#include <phase3_usermode.h>
+#include <stdio.h>
+#include <limits.h>
+
+#define NUM_LARGE   20
+#define NUM_SMALL   150
+
+
+int start3(void *arg)
+{
+    int large[NUM_LARGE];
+    int small[NUM_SMALL];
+    int sem;
+
+    USLOSS_Console("start3(): started\n");
+
+    // Interleave the large and small semaphores, so that neither kind can starve the other
+    int value = INT_MAX / 2;
+    for (int i = 0; i < NUM_LARGE; i++)
+    {
+        if (SemCreate(value, &large[i]) != 0)
+        {
+            USLOSS_Console("start3(): SemCreate(%d) failed\n", value);
+            Terminate(1);
+        }
+        value /= 2;
+
+        for (int j = i; j < NUM_SMALL; j += NUM_LARGE)
+        {
+            if (SemCreate(j % 4, &small[j]) != 0)
+            {
+                USLOSS_Console("start3(): SemCreate(%d) failed\n", j % 4);
+                Terminate(1);
+            }
+        }
+    }
+    USLOSS_Console("start3(): created %d large and %d small semaphores\n", NUM_LARGE, NUM_SMALL);
+
+    // P never blocks on a large semaphore
+    for (int i = 0; i < 1000; i++)
+        SemP(large[0]);
+    for (int i = 0; i < 1000; i++)
+        SemV(large[0]);
+    USLOSS_Console("start3(): 1000 P's and V's on the INT_MAX/2 semaphore completed\n");
+
+    // A V past INT_MAX must fail, rather than wrap around
+    SemCreate(INT_MAX, &sem);
+    USLOSS_Console("start3(): SemV on an INT_MAX semaphore returned %d\n", SemV(sem));
+    USLOSS_Console("start3(): SemP on an INT_MAX semaphore returned %d\n", SemP(sem));
+    USLOSS_Console("start3(): SemV after the P returned %d\n", SemV(sem));
+
+    USLOSS_Console("start3(): done\n");
+    Terminate(0);
+}
@@ -0,0 +1,84 @@
+/*
+ * Multi-unit semaphore test.  Checks that N separate SemV calls or a single
+ * SemVN(N) both leave exactly N units for a SemPN(N), that one SemVN wakes
+ * every waiter it has units for, that a SemPN waiter is only woken once
+ * enough units are available, and that a count of zero neither takes nor
+ * releases a unit.  The timing comparison is benchmarks/bench_sem_vn.c.
+ */
+
+#include <usloss.h>
+#include <usyscall.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <phase3_usermode.h>
+#include <stdio.h>
+
+#define BATCH       32
+#define NUM_WAITERS 4
+
+int Waiter(void *);
+int BigWaiter(void *);
+
+int semaphore;
+
+
+int start3(void *arg)
+{
+    int pid, status;
+
+    USLOSS_Console("start3(): started\n");
+
+    SemCreate(0, &semaphore);
+
+    // N single V's, drained by one P(N) without blocking
+    for (int i = 0; i < BATCH; i++)
+        SemV(semaphore);
+    SemPN(semaphore, BATCH);
+    USLOSS_Console("start3(): %d x SemV, then SemPN(%d); SemTryP returned %d\n", BATCH, BATCH, SemTryP(semaphore));
+
+    // One V(N), drained the same way
+    SemVN(semaphore, BATCH);
+    SemPN(semaphore, BATCH);
+    USLOSS_Console("start3(): SemVN(%d), then SemPN(%d); SemTryP returned %d\n", BATCH, BATCH, SemTryP(semaphore));
+
+    // A single V(n) wakes all the single-unit waiters at once
+    for (int i = 0; i < NUM_WAITERS; i++)
+        Spawn("Waiter", Waiter, NULL, USLOSS_MIN_STACK, 2, &pid);
+    USLOSS_Console("start3(): calling SemVN(%d)\n", NUM_WAITERS);
+    SemVN(semaphore, NUM_WAITERS);
+    for (int i = 0; i < NUM_WAITERS; i++)
+        Wait(&pid, &status);
+
+    // A P(3) waiter stays blocked until three units have been released
+    Spawn("BigWaiter", BigWaiter, NULL, USLOSS_MIN_STACK, 2, &pid);
+    USLOSS_Console("start3(): calling SemVN(2)\n");
+    SemVN(semaphore, 2);
+    USLOSS_Console("start3(): calling SemV -- BigWaiter should wake after this\n");
+    SemV(semaphore);
+    Wait(&pid, &status);
+
+    USLOSS_Console("start3(): SemPN with a negative count returned %d\n", SemPN(semaphore, -1));
+
+    // A count of zero moves no units either way
+    USLOSS_Console("start3(): SemVN(0) returned %d, SemPN(0) returned %d\n", SemVN(semaphore, 0), SemPN(semaphore, 0));
+    USLOSS_Console("start3(): SemTryP afterwards returned %d (semaphore still empty)\n", SemTryP(semaphore));
+
+    USLOSS_Console("start3(): done\n");
+    Terminate(0);
+}
+
+
+int Waiter(void *arg)
+{
+    SemP(semaphore);
+    USLOSS_Console("Waiter(): got one unit\n");
+    return 0;
+}
+
+
+int BigWaiter(void *arg)
+{
+    SemPN(semaphore, 3);
+    USLOSS_Console("BigWaiter(): got three units\n");
+    return 0;
+}
@@ -0,0 +1,85 @@
+/*
+ * SemOp test: acquires "slot free" and "lock" together with a single
+ * all-or-nothing call.  While the lock is held, a SemOp that needs both
+ * semaphores must block without taking the free slot, so another process
+ * can still P the slot semaphore on its own.  Also checks that invalid
+ * vectors are rejected.
+ */
+
+#include <usloss.h>
+#include <usyscall.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <phase3_usermode.h>
+#include <stdio.h>
+#include <limits.h>
+
+int Both(void *);
+int SlotOnly(void *);
+
+int slots, lock;
+
+
+int start3(void *arg)
+{
+    int pid, status;
+
+    USLOSS_Console("start3(): started\n");
+
+    SemCreate(1, &slots);
+    SemCreate(1, &lock);
+
+    // Take the lock, so that Both() can't get everything it needs
+    SemP(lock);
+
+    Spawn("Both", Both, NULL, USLOSS_MIN_STACK, 2, &pid);
+    USLOSS_Console("start3(): Both() is blocked; spawning SlotOnly()\n");
+
+    // The slot must still be free, since Both() takes nothing until it can take everything
+    Spawn("SlotOnly", SlotOnly, NULL, USLOSS_MIN_STACK, 2, &pid);
+    Wait(&pid, &status);
+    USLOSS_Console("start3(): SlotOnly() finished with status %d\n", status);
+
+    USLOSS_Console("start3(): releasing the lock -- Both() should run after this\n");
+    SemV(lock);
+    Wait(&pid, &status);
+    USLOSS_Console("start3(): Both() finished with status %d\n", status);
+
+    // Invalid vectors
+    SemOpEntry dup[2] = { { slots, -1 }, { slots, -1 } };
+    USLOSS_Console("start3(): SemOp with a duplicate sid returned %d\n", SemOp(dup, 2));
+
+    SemOpEntry bad[2] = { { slots, -1 }, { 12345, -1 } };
+    USLOSS_Console("start3(): SemOp with an invalid sid returned %d\n", SemOp(bad, 2));
+
+    USLOSS_Console("start3(): SemOp with an empty vector returned %d\n", SemOp(bad, 0));
+
+    SemOpEntry huge[1] = { { slots, INT_MIN } };
+    USLOSS_Console("start3(): SemOp with a delta of INT_MIN returned %d\n", SemOp(huge, 1));
+
+    USLOSS_Console("start3(): done\n");
+    Terminate(0);
+}
+
+
+int Both(void *arg)
+{
+    SemOpEntry acquire[2] = { { slots, -1 }, { lock, -1 } };
+    SemOpEntry release[2] = { { slots, 1 }, { lock, 1 } };
+
+    USLOSS_Console("Both(): acquiring slot and lock together\n");
+    int rc = SemOp(acquire, 2);
+    USLOSS_Console("Both(): acquired both, rc = %d\n", rc);
+
+    SemOp(release, 2);
+    return 1;
+}
+
+
+int SlotOnly(void *arg)
+{
+    SemP(slots);
+    USLOSS_Console("SlotOnly(): took the slot\n");
+    SemV(slots);
+    return 2;
+}
@@ -0,0 +1,93 @@
+/*
+ * SemTryP / SemTimedP test.  SemTryP must fail immediately on an empty
+ * semaphore, and SemTimedP must give up within one clock tick of its
+ * deadline.  A timed-out waiter must also be gone from the semaphore's
+ * queue, so a later V isn't lost on it.  A timeout too large to add to the
+ * current time must wait for the V rather than time out at once.
+ */
+
+#include <usloss.h>
+#include <usyscall.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <phase3_usermode.h>
+#include <stdio.h>
+#include <limits.h>
+
+#define TICK_US     (USLOSS_CLOCK_MS * 1000)
+
+int TimedWaiter(void *);
+int Releaser(void *);
+
+int semaphore;
+
+
+// Runs one SemTimedP and reports whether it timed out within a tick of the deadline
+void check_timeout(int usec)
+{
+    int start, end;
+
+    GetTimeofDay(&start);
+    int rc = SemTimedP(semaphore, usec);
+    GetTimeofDay(&end);
+
+    int late = (end - start) - usec;
+    USLOSS_Console("start3(): SemTimedP(%d us) returned %d; within one tick of the deadline: %s\n",
+                   usec, rc, (late >= 0 && late <= TICK_US) ? "yes" : "NO");
+}
+
+
+int start3(void *arg)
+{
+    int pid, status;
+
+    USLOSS_Console("start3(): started\n");
+
+    SemCreate(0, &semaphore);
+
+    USLOSS_Console("start3(): SemTryP on an empty semaphore returned %d\n", SemTryP(semaphore));
+
+    check_timeout(TICK_US / 2);
+    check_timeout(3 * TICK_US);
+    check_timeout(10 * TICK_US + 1234);
+
+    // A zero or negative timeout behaves like SemTryP
+    USLOSS_Console("start3(): SemTimedP(0) returned %d\n", SemTimedP(semaphore, 0));
+    USLOSS_Console("start3(): SemTimedP(-5) returned %d\n", SemTimedP(semaphore, -5));
+
+    // The timed-out waits must not have left anyone on the queue to swallow this V
+    SemV(semaphore);
+    USLOSS_Console("start3(): SemTryP after a V returned %d\n", SemTryP(semaphore));
+
+    // A V before the deadline wins
+    Spawn("TimedWaiter", TimedWaiter, (void *)(long)(100 * TICK_US), USLOSS_MIN_STACK, 2, &pid);
+    Spawn("Releaser", Releaser, NULL, USLOSS_MIN_STACK, 4, &pid);
+    Wait(&pid, &status);
+    Wait(&pid, &status);
+
+    // Even when the deadline would overflow an int
+    Spawn("TimedWaiter", TimedWaiter, (void *)(long)INT_MAX, USLOSS_MIN_STACK, 2, &pid);
+    Spawn("Releaser", Releaser, NULL, USLOSS_MIN_STACK, 4, &pid);
+    Wait(&pid, &status);
+    Wait(&pid, &status);
+
+    USLOSS_Console("start3(): done\n");
+    Terminate(0);
+}
+
+
+int TimedWaiter(void *arg)
+{
+    int usec = (int)(long)arg;
+    int rc = SemTimedP(semaphore, usec);
+    USLOSS_Console("TimedWaiter(): SemTimedP(%d us) returned %d\n", usec, rc);
+    return 0;
+}
+
+
+int Releaser(void *arg)
+{
+    USLOSS_Console("Releaser(): calling SemV\n");
+    SemV(semaphore);
+    return 0;
+}
@@ -0,0 +1,77 @@
+/*
+ * SpawnMany test.  Launches a batch of workers with a single SpawnMany and
+ * checks that each PID it reports belongs to the child that got the
+ * matching argument.  Then asks SpawnMany for more children than the process
+ * table can hold, and checks that it reports how many it managed to create.
+ * The comparison against a loop of Spawn calls is
+ * benchmarks/bench_spawn_many.c.
+ */
+
+#include <usloss.h>
+#include <usyscall.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <phase3_usermode.h>
+#include <stdio.h>
+
+#define BATCH   32
+
+int Worker(void *);
+
+int pids[MAXPROC];
+void *worker_args[MAXPROC];
+
+
+void reap(int count)
+{
+    int pid, status;
+    for (int i = 0; i < count; i++)
+        Wait(&pid, &status);
+}
+
+
+// Reaps a batch, counting the children whose status doesn't match the argument SpawnMany gave their PID
+int reap_and_check(int count)
+{
+    int pid, status;
+    int mismatches = 0;
+
+    for (int i = 0; i < count; i++)
+    {
+        Wait(&pid, &status);
+        if (status < 0 || status >= count || pids[status] != pid)
+            mismatches++;
+    }
+    return mismatches;
+}
+
+
+int start3(void *arg)
+{
+    USLOSS_Console("start3(): started\n");
+
+    for (long i = 0; i < MAXPROC; i++)
+        worker_args[i] = (void *)i;
+
+    int spawned = SpawnMany("Worker", Worker, worker_args, BATCH, USLOSS_MIN_STACK, 4, pids);
+    USLOSS_Console("start3(): SpawnMany(%d) created %d children\n", BATCH, spawned);
+    USLOSS_Console("start3(): reaped them with %d mismatched PIDs\n", reap_and_check(spawned));
+
+    // Partial success: the process table fills up before all MAXPROC children exist
+    int created = SpawnMany("Worker", Worker, worker_args, MAXPROC, USLOSS_MIN_STACK, 4, pids);
+    USLOSS_Console("start3(): SpawnMany(%d) created %d children; pids[%d] = %d\n",
+                   MAXPROC, created, created, pids[created]);
+    reap(created);
+
+    USLOSS_Console("start3(): SpawnMany with a negative count returned %d\n",
+                   SpawnMany("Worker", Worker, NULL, -1, USLOSS_MIN_STACK, 4, pids));
+
+    USLOSS_Console("start3(): done\n");
+    Terminate(0);
+}
+
+
+int Worker(void *arg)
+{
+    return (int)(long)arg;
+}
@@ -0,0 +1,75 @@
+/*
+ * WaitPid test.  Spawns 42 children, then reaps them in the reverse of the
+ * order they were spawned, checking that each WaitPid returns the status of
+ * exactly the child asked for.  Also checks WAIT_NOHANG on a child that
+ * hasn't terminated yet, and WaitPid on a pid that isn't a child.
+ */
+
+#include <usloss.h>
+#include <usyscall.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <phase3_usermode.h>
+#include <stdio.h>
+
+#define NUM_CHILDREN 42
+
+int Child(void *);
+int Sleeper(void *);
+
+int gate;
+
+
+int start3(void *arg)
+{
+    int pids[NUM_CHILDREN];
+    int pid, status, rc;
+    int mismatches = 0;
+
+    USLOSS_Console("start3(): started\n");
+
+    SemCreate(0, &gate);
+
+    // The children are lower priority, so none of them run until we block
+    for (long i = 0; i < NUM_CHILDREN - 1; i++)
+        Spawn("Child", Child, (void *)i, USLOSS_MIN_STACK, 4, &pids[i]);
+    Spawn("Sleeper", Sleeper, NULL, USLOSS_MIN_STACK, 2, &pids[NUM_CHILDREN - 1]);
+
+    // Sleeper is blocked on the gate, so it can't be reaped yet
+    rc = WaitPid(pids[NUM_CHILDREN - 1], &status, WAIT_NOHANG);
+    USLOSS_Console("start3(): WaitPid(WAIT_NOHANG) on a blocked child returned %d\n", rc);
+    SemV(gate);
+
+    // Reap in reverse spawn order
+    for (int i = NUM_CHILDREN - 1; i >= 0; i--)
+    {
+        pid = WaitPid(pids[i], &status, 0);
+        int expected = (i == NUM_CHILDREN - 1) ? 100 : i;
+        if (pid != pids[i] || status != expected)
+        {
+            USLOSS_Console("start3(): WaitPid(%d) returned pid %d, status %d (expected status %d)\n", pids[i], pid, status, expected);
+            mismatches++;
+        }
+    }
+    USLOSS_Console("start3(): reaped %d children out of order, %d mismatches\n", NUM_CHILDREN, mismatches);
+
+    USLOSS_Console("start3(): WaitPid on a reaped child returned %d\n", WaitPid(pids[0], &status, 0));
+    USLOSS_Console("start3(): WaitPid(-1) with no children returned %d\n", WaitPid(-1, &status, WAIT_NOHANG));
+    USLOSS_Console("start3(): Wait with no children returned %d\n", Wait(&pid, &status));
+
+    USLOSS_Console("start3(): done\n");
+    Terminate(0);
+}
+
+
+int Child(void *arg)
+{
+    return (int)(long)arg;
+}
+
+
+int Sleeper(void *arg)
+{
+    SemP(gate);
+    return 100;
+}
@@ -0,0 +1,55 @@
+/*
+ * Detached Spawn test.  Launches far more detached workers than MAXPROC
+ * without ever calling Wait, and checks that every one of them ran.  That
+ * only works if each worker's slot is freed once it has terminated, without
+ * a Wait.  The parent has no children to Wait for afterwards.
+ */
+
+#include <usloss.h>
+#include <usyscall.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <phase3_usermode.h>
+#include <stdio.h>
+
+#define NUM_WORKERS (10 * MAXPROC)
+
+int Worker(void *);
+
+int finished;
+
+
+int start3(void *arg)
+{
+    int pid, status;
+
+    USLOSS_Console("start3(): started\n");
+
+    SemCreate(0, &finished);
+
+    for (int i = 0; i < NUM_WORKERS; i++)
+    {
+        if (SpawnDetached("Worker", Worker, NULL, USLOSS_MIN_STACK, 4, &pid) != 0 || pid < 0)
+        {
+            USLOSS_Console("start3(): SpawnDetached #%d failed\n", i);
+            Terminate(1);
+        }
+
+        // Let the workers run every so often, as a long-running service would
+        if (i % 20 == 19)
+            SemPN(finished, 20);
+    }
+
+    USLOSS_Console("start3(): %d detached workers ran\n", NUM_WORKERS);
+    USLOSS_Console("start3(): Wait with only detached children returned %d\n", Wait(&pid, &status));
+
+    USLOSS_Console("start3(): done\n");
+    Terminate(0);
+}
+
+
+int Worker(void *arg)
+{
+    SemV(finished);
+    return 0;
+}
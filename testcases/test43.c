@@ -0,0 +1,82 @@
+/*
+ * Worker pool test: hands a batch of tasks to SubmitWork and checks that
+ * every one of them ran with the argument it was given, and that a NULL
+ * task is refused.  Then checks that the pool survives tasks that call
+ * Terminate, which takes their worker down with them.  The comparison
+ * against Spawn + Wait is benchmarks/bench_submit_work.c.
+ */
+
+#include <usloss.h>
+#include <usyscall.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <phase3_usermode.h>
+#include <stdio.h>
+
+#define TASKS       20 // More than the pool ever holds at once
+#define DYING_TASKS 10
+
+int Task(void *);
+int DyingTask(void *);
+
+int done_sem;
+int ran[TASKS];
+
+
+int start3(void *arg)
+{
+    int missing = 0;
+
+    USLOSS_Console("start3(): started\n");
+
+    SemCreate(0, &done_sem);
+
+    for (long i = 0; i < TASKS; i++)
+    {
+        if (SubmitWork(Task, (void *)i) != 0)
+            USLOSS_Console("start3(): SubmitWork #%ld failed\n", i);
+    }
+    SemPN(done_sem, TASKS);
+
+    for (int i = 0; i < TASKS; i++)
+    {
+        if (ran[i] != 1)
+            missing++;
+    }
+    USLOSS_Console("start3(): %d tasks submitted, %d did not run exactly once\n", TASKS, missing);
+
+    USLOSS_Console("start3(): SubmitWork of a NULL task returned %d\n", SubmitWork(NULL, NULL));
+
+    // Every one of these kills its worker, so the pool has to replace them
+    for (int i = 0; i < DYING_TASKS; i++)
+    {
+        if (SubmitWork(DyingTask, NULL) != 0)
+            USLOSS_Console("start3(): SubmitWork of a dying task failed\n");
+        SemP(done_sem);
+    }
+    ran[0] = 0;
+    SubmitWork(Task, (void *)0L);
+    SemP(done_sem);
+    USLOSS_Console("start3(): a task submitted after %d tasks called Terminate %s\n",
+                   DYING_TASKS, ran[0] == 1 ? "still ran" : "DID NOT RUN");
+
+    USLOSS_Console("start3(): done\n");
+    Terminate(0);
+}
+
+
+// Records that it ran, then reports that it's done
+int Task(void *arg)
+{
+    ran[(long)arg]++;
+    SemV(done_sem);
+    return 0;
+}
+
+
+// Reports that it's done, then terminates the worker it's running on
+int DyingTask(void *arg)
+{
+    SemV(done_sem);
+    Terminate(1);
+}
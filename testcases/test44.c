@@ -0,0 +1,77 @@
+/*
+ * Data page test: GetPID reads the kernel's user data page instead of
+ * trapping, so it must agree with a trapped SYS_GETPID in every process,
+ * including right after the process has been switched out and back in, and
+ * in one that starts running without ever having made a syscall.  The
+ * microbenchmark is benchmarks/bench_data_page.c.
+ */
+
+#include <usloss.h>
+#include <usyscall.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <phase3_usermode.h>
+#include <stdio.h>
+#include <string.h>
+
+#define NUM_CHILDREN 3
+
+int Child(void *);
+
+int turn_sem;
+
+
+// A GetPID that always traps, like the stub did before the data page
+int trapped_pid()
+{
+    USLOSS_Sysargs args;
+
+    memset(&args, 0, sizeof(args));
+    args.number = SYS_GETPID;
+    USLOSS_Syscall(&args);
+
+    return (int)(long)args.arg1;
+}
+
+
+void check(char *who)
+{
+    int pid;
+
+    GetPID(&pid);
+    int trapped = trapped_pid();
+    USLOSS_Console("%s: GetPID %s the trapped PID (%d)\n", who, pid == trapped ? "matches" : "DIFFERS FROM", trapped);
+}
+
+
+int start3(void *arg)
+{
+    int pid, status;
+
+    USLOSS_Console("start3(): started\n");
+    check("start3()");
+
+    SemCreate(0, &turn_sem);
+
+    // Higher priority than us, so each child runs straight away and then blocks, handing the CPU back
+    for (int i = 0; i < NUM_CHILDREN; i++)
+        Spawn("Child", Child, NULL, USLOSS_MIN_STACK, 2, &pid);
+    check("start3() after the children blocked");
+
+    SemVN(turn_sem, NUM_CHILDREN);
+    for (int i = 0; i < NUM_CHILDREN; i++)
+        Wait(&pid, &status);
+    check("start3() after the children finished");
+
+    USLOSS_Console("start3(): done\n");
+    Terminate(0);
+}
+
+
+int Child(void *arg)
+{
+    check("Child() on its first instruction");
+    SemP(turn_sem);
+    check("Child() after blocking");
+    return 0;
+}
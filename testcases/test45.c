@@ -0,0 +1,73 @@
+/*
+ * Syscall instrumentation: turns the per-syscall stats on, makes a known
+ * mix of syscalls, and checks the counts SyscallStats reports for them.
+ * Calls made before instrumentation was turned on, or after it was turned
+ * off, must not be counted.  The overhead of the wrapper is measured by
+ * benchmarks/bench_syscall_stats.c.
+ */
+
+#include <usloss.h>
+#include <usyscall.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <phase3.h>
+#include <phase3_usermode.h>
+#include <stdio.h>
+
+#define CALLS 10000
+
+int Child(void *);
+
+
+void report(char *name, int number)
+{
+    SyscallStat stat;
+
+    if (SyscallStats(number, &stat) != 0)
+    {
+        USLOSS_Console("start3(): SyscallStats(%d) failed\n", number);
+        return;
+    }
+
+    USLOSS_Console("start3(): %-10s count %5d\n", name, stat.count);
+}
+
+
+int start3(void *arg)
+{
+    int sem, pid, status;
+
+    USLOSS_Console("start3(): started\n");
+
+    SemCreate(0, &sem);
+    for (int i = 0; i < CALLS; i++)
+        SemV(sem);
+
+    SyscallStatsEnable(1);
+    for (int i = 0; i < CALLS; i++)
+        SemV(sem);
+
+    for (int i = 0; i < 2 * CALLS; i++)
+        SemP(sem);
+
+    Spawn("Child", Child, NULL, USLOSS_MIN_STACK, 2, &pid);
+    Wait(&pid, &status);
+
+    SyscallStatsEnable(0);
+    SemV(sem);
+
+    report("SemV", SYS_SEMV);
+    report("SemP", SYS_SEMP);
+    report("Spawn", SYS_SPAWN);
+    report("Wait", SYS_WAIT);
+    report("Terminate", SYS_TERMINATE);
+
+    USLOSS_Console("start3(): done\n");
+    Terminate(0);
+}
+
+
+int Child(void *arg)
+{
+    return 3;
+}
@@ -0,0 +1,92 @@
+/*
+ * Semaphore contention stats: a producer feeds four consumers through a
+ * bounded buffer, so that the "items" semaphore is hot and "slots" only
+ * blocks the producer now and then, while "idle" is never touched.  Asks
+ * SemStatsTop for the most contended semaphores and prints their counts.
+ * The semaphores are freed before halting, since the report at halt would
+ * list their blocked times, which differ from run to run.
+ */
+
+#include <usloss.h>
+#include <usyscall.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <phase3_usermode.h>
+#include <stdio.h>
+
+#define CONSUMERS 4
+#define ITEMS     200
+#define SLOTS     8
+
+int Producer(void *);
+int Consumer(void *);
+
+int items_sem, slots_sem, idle_sem;
+
+
+int start3(void *arg)
+{
+    int pid, status, count;
+    SemStats stats[3];
+
+    USLOSS_Console("start3(): started\n");
+
+    SemCreate(0, &items_sem);
+    SemCreate(SLOTS, &slots_sem);
+    SemCreate(0, &idle_sem);
+    SemName(items_sem, "items");
+    SemName(slots_sem, "slots");
+    SemName(idle_sem, "idle");
+
+    for (int i = 0; i < CONSUMERS; i++)
+        Spawn("Consumer", Consumer, NULL, USLOSS_MIN_STACK, 2, &pid);
+    Spawn("Producer", Producer, NULL, USLOSS_MIN_STACK, 3, &pid);
+
+    for (int i = 0; i < CONSUMERS + 1; i++)
+        Wait(&pid, &status);
+
+    SemStatsTop(stats, 3, &count);
+
+    USLOSS_Console("start3(): %d contended semaphores\n", count);
+    for (int i = 0; i < count; i++)
+    {
+        USLOSS_Console("start3(): %-6s %d Ps, %s blocked, peak of %d waiting\n", stats[i].name, stats[i].p_count,
+                       stats[i].blocked_count > 0 ? "some" : "none", stats[i].max_waiting);
+    }
+
+    SemFree(items_sem);
+    SemFree(slots_sem);
+    SemFree(idle_sem);
+
+    USLOSS_Console("start3(): done\n");
+    Terminate(0);
+}
+
+
+int Producer(void *arg)
+{
+    for (int i = 0; i < ITEMS; i++)
+    {
+        SemP(slots_sem);
+        SemV(items_sem);
+    }
+
+    // One extra item per consumer tells it to stop
+    for (int i = 0; i < CONSUMERS; i++)
+        SemV(items_sem);
+
+    return 0;
+}
+
+
+int Consumer(void *arg)
+{
+    for (int i = 0; i < ITEMS / CONSUMERS; i++)
+    {
+        SemP(items_sem);
+        SemV(slots_sem);
+    }
+
+    SemP(items_sem);
+    return 0;
+}
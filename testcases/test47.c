@@ -0,0 +1,116 @@
+/*
+ * Sys_GetProcInfo accounting: runs a CPU hog, a process that spends its time
+ * blocked on a semaphore, and a parent that blocks in Wait, then checks
+ * that each one's time shows up in the right bucket.  Also checks the
+ * syscall count and stack size, which are exact.
+ */
+
+#include <usloss.h>
+#include <usyscall.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <phase3_usermode.h>
+#include <libuser.h>
+#include <stdio.h>
+
+#define HOG_US   200000
+#define SEM_CALLS 20
+
+int Hog(void *);
+int Blocker(void *);
+int Parent(void *);
+int Child(void *);
+
+int sem;
+ProcInfo hog_info, blocker_info, parent_info;
+
+
+int start3(void *arg)
+{
+    int pid, status;
+
+    USLOSS_Console("start3(): started\n");
+
+    SemCreate(0, &sem);
+
+    Spawn("Blocker", Blocker, NULL, USLOSS_MIN_STACK, 2, &pid);
+    Spawn("Hog", Hog, NULL, 2 * USLOSS_MIN_STACK, 3, &pid);
+    Spawn("Parent", Parent, NULL, USLOSS_MIN_STACK, 3, &pid);
+
+    for (int i = 0; i < 3; i++)
+        Wait(&pid, &status);
+
+    USLOSS_Console("start3(): Hog: stack %d, cpu %s sem-blocked time, %s context switch\n", hog_info.stack_size,
+                   hog_info.cpu_time > hog_info.blocked_sem ? "more than" : "NOT more than",
+                   hog_info.context_switches > 0 ? "at least one" : "NO");
+    USLOSS_Console("start3(): Blocker: %d syscalls, sem-blocked %s cpu time\n", blocker_info.syscalls,
+                   blocker_info.blocked_sem > blocker_info.cpu_time ? "more than" : "NOT more than");
+    USLOSS_Console("start3(): Parent: wait-blocked time %s, io-blocked time %d\n",
+                   parent_info.blocked_wait > 0 ? "counted" : "NOT counted", parent_info.blocked_io);
+
+    USLOSS_Console("start3(): done\n");
+    Terminate(0);
+}
+
+
+// Spins in user mode, with a syscall only now and then to watch the clock
+int Hog(void *arg)
+{
+    int start, now;
+
+    GetTimeofDay(&start);
+    do
+    {
+        for (int i = 0; i < 10000; i++)
+            ;
+        GetTimeofDay(&now);
+    } while (now - start < HOG_US);
+
+    // The Blocker is waiting for us, so the V's each hand it the CPU
+    for (int i = 0; i < SEM_CALLS; i++)
+        SemV(sem);
+
+    if (Sys_GetProcInfo(-1, &hog_info) != 0)
+        USLOSS_Console("Hog(): Sys_GetProcInfo failed\n");
+    return 0;
+}
+
+
+// Blocks on the semaphore SEM_CALLS times; together with Sys_GetProcInfo that's SEM_CALLS + 1 syscalls
+int Blocker(void *arg)
+{
+    for (int i = 0; i < SEM_CALLS; i++)
+        SemP(sem);
+
+    if (Sys_GetProcInfo(-1, &blocker_info) != 0)
+        USLOSS_Console("Blocker(): Sys_GetProcInfo failed\n");
+    return 0;
+}
+
+
+int Parent(void *arg)
+{
+    int pid, status;
+
+    Spawn("Child", Child, NULL, USLOSS_MIN_STACK, 4, &pid);
+    Wait(&pid, &status);
+
+    if (Sys_GetProcInfo(-1, &parent_info) != 0)
+        USLOSS_Console("Parent(): Sys_GetProcInfo failed\n");
+    return 0;
+}
+
+
+// Runs at a lower priority than its parent, so the parent is blocked in Wait the whole time
+int Child(void *arg)
+{
+    int start, now;
+
+    GetTimeofDay(&start);
+    do
+    {
+        GetTimeofDay(&now);
+    } while (now - start < HOG_US / 4);
+
+    return 0;
+}
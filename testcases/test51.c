@@ -0,0 +1,90 @@
+/*
+ * SEM_HANDOFF ordering test.  A process waiting for three units is queued
+ * on a handoff semaphore that only has two.  A later SemTryP, SemP or
+ * SemOp of one unit must not take those two units out from under it: each
+ * one either fails or queues up behind it, and is only served once the
+ * first waiter has had its three.  On a default semaphore, the same SemTryP
+ * succeeds straight away.
+ */
+
+#include <usloss.h>
+#include <usyscall.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <phase3_usermode.h>
+#include <stdio.h>
+
+int BigWaiter(void *);
+int SmallWaiter(void *);
+int OpWaiter(void *);
+
+int semaphore;
+
+
+int start3(void *arg)
+{
+    int pid, status;
+
+    USLOSS_Console("start3(): started\n");
+
+    SemCreateFlags(0, SEM_HANDOFF, &semaphore);
+
+    Spawn("BigWaiter", BigWaiter, NULL, USLOSS_MIN_STACK, 2, &pid);
+    SemVN(semaphore, 2);
+
+    USLOSS_Console("start3(): two units available; SemTryP returned %d\n", SemTryP(semaphore));
+
+    Spawn("SmallWaiter", SmallWaiter, NULL, USLOSS_MIN_STACK, 2, &pid);
+    Spawn("OpWaiter", OpWaiter, NULL, USLOSS_MIN_STACK, 2, &pid);
+    USLOSS_Console("start3(): SmallWaiter() and OpWaiter() are queued; calling SemV\n");
+
+    // BigWaiter() gets all three units; nobody else gets anything yet
+    SemV(semaphore);
+    Wait(&pid, &status);
+    USLOSS_Console("start3(): BigWaiter() finished with status %d; calling SemVN(2)\n", status);
+
+    SemVN(semaphore, 2);
+    Wait(&pid, &status);
+    Wait(&pid, &status);
+    SemFree(semaphore);
+
+    // Without SEM_HANDOFF, a P that fits takes its units whoever is waiting
+    SemCreate(0, &semaphore);
+    Spawn("BigWaiter", BigWaiter, NULL, USLOSS_MIN_STACK, 2, &pid);
+    SemVN(semaphore, 2);
+    USLOSS_Console("start3(): default semaphore; SemTryP returned %d\n", SemTryP(semaphore));
+    SemVN(semaphore, 2);
+    Wait(&pid, &status);
+
+    USLOSS_Console("start3(): done\n");
+    Terminate(0);
+}
+
+
+int BigWaiter(void *arg)
+{
+    USLOSS_Console("BigWaiter(): waiting for 3 units\n");
+    SemPN(semaphore, 3);
+    USLOSS_Console("BigWaiter(): got 3 units\n");
+    return 3;
+}
+
+
+int SmallWaiter(void *arg)
+{
+    USLOSS_Console("SmallWaiter(): waiting for 1 unit\n");
+    SemP(semaphore);
+    USLOSS_Console("SmallWaiter(): got 1 unit\n");
+    return 1;
+}
+
+
+int OpWaiter(void *arg)
+{
+    SemOpEntry op = { semaphore, -1 };
+
+    USLOSS_Console("OpWaiter(): waiting for 1 unit through SemOp\n");
+    SemOp(&op, 1);
+    USLOSS_Console("OpWaiter(): got 1 unit\n");
+    return 1;
+}
@@ -269,7 +269,8 @@ int Sys_GetTimeOfDay(int *tod)
  *  Description: This is the call entry point for the process's info.
  *      
  *
- *  Arguments:    void *info  -- pointer to P1_ProcInfo
+ *  Arguments:    int pid     -- process to report on, or -1 for the caller
+ *                void *info  -- pointer to a ProcInfo (see phase3_usermode.h)
  *
  */
 int Sys_GetProcInfo(int pid, void *info)                           
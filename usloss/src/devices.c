@@ -1,5 +1,6 @@
 
 #include <stdio.h>
+#include <stdlib.h>
 #include "project.h"
 #include "globals.h"
 #include "usloss.h"
@@ -7,14 +8,41 @@
 #include "dev_clock.h"
 #include "dev_disk.h"
 #include "dev_term.h"
+#include "sig_ints.h"
 
-static struct {
-    int		device;
-    void	*arg;
-} dev_event_queue[256];		// Indexed by unsigned char - must be
-				// 256 (major changes if not) */
+/*
+ *  Pending device events, kept in a binary min-heap ordered by due time,
+ *  then by device priority (lower device numbers first), then by the
+ *  order they were scheduled in, so that the order of delivery is fully
+ *  deterministic. Events can be any number of ticks in the future, any
+ *  number can share a tick, and the heap grows as needed.
+ */
+typedef struct dev_event {
+    unsigned long	time;		/*  Device tick the event is due */
+    int			device;
+    void		*arg;
+    unsigned long	seq;		/*  Breaks ties, oldest first */
+} dev_event;
+
+#define DEV_EVENTS_INITIAL 1024
+
+/*
+ *  Time in the queue is counted in alarm signals. The clock interrupts on
+ *  every other signal and the terminals are polled on the signals in
+ *  between; device delays are given in device ticks of the same length
+ *  as a clock period.
+ */
+#define CLOCK_PERIOD	2
+#define TERM_POLL_PERIOD	2
+#define DEV_TICK	CLOCK_PERIOD
+
+static dev_event	*dev_events;
+static int		num_dev_events;
+static int		max_dev_events;
+static unsigned long	dev_event_seq;
+static unsigned long	dev_tick;	/*  Alarm signals dispatched so far */
 
-static unsigned char dev_event_ptr;	/*  Index into queue of pending ints */
+static void push_event(unsigned long time, int device, void *arg);
 
 void (*USLOSS_IntVec[USLOSS_NUM_INTS])(int dev, void *arg);	/*  Interrupt vector table */
      
@@ -26,9 +54,17 @@ dynamic_fun void devices_init(void)
     int count;
 
     /*  Initialize the device event queue */
-    for (count = 0; count < 256; count++)
-	dev_event_queue[count].device = LOW_PRI_DEV;
-    dev_event_ptr = 0;
+    max_dev_events = DEV_EVENTS_INITIAL;
+    dev_events = malloc(max_dev_events * sizeof(dev_event));
+    usloss_sys_assert(dev_events != NULL, "out of memory for the device event queue");
+    num_dev_events = 0;
+    dev_event_seq = 0;
+    dev_tick = 0;
+
+    /*  The clock and the terminal poll are periodic events, one each
+	per device tick, on alternate signals */
+    push_event(1, USLOSS_CLOCK_DEV, NULL);
+    push_event(2, USLOSS_TERM_DEV, NULL);
     /*  Initialize the device status and interrupt vector tables */
     for (count = 0; count < USLOSS_NUM_INTS; count++)
     {
@@ -37,50 +73,113 @@ dynamic_fun void devices_init(void)
 }
 
 /*
- *  Schedule an interrupt for a given number of clock ticks (must be < 255)
- *  in the future.  When two interrupts are scheduled for the same tick,
- *  the interrupt with lower priority is assigned to a later tick.
+ *  Returns TRUE if event a must be delivered before event b.
+ */
+static int event_before(dev_event *a, dev_event *b)
+{
+    if (a->time != b->time)
+	return a->time < b->time;
+    if (a->device != b->device)
+	return a->device < b->device;
+    return a->seq < b->seq;
+}
+
+/*
+ *  Adds an event to the queue, due on the given tick.
+ */
+static void push_event(unsigned long time, int device, void *arg)
+{
+    dev_event	event;
+    int		index;
+
+    event.time = time;
+    event.device = device;
+    event.arg = arg;
+    event.seq = dev_event_seq++;
+
+    if (num_dev_events == max_dev_events)
+    {
+	max_dev_events *= 2;
+	dev_events = realloc(dev_events, max_dev_events * sizeof(dev_event));
+	usloss_sys_assert(dev_events != NULL, "out of memory for the device event queue");
+    }
+
+    /*  Sift up from the new leaf */
+    index = num_dev_events++;
+    while (index > 0 && event_before(&event, &dev_events[(index - 1) / 2]))
+    {
+	dev_events[index] = dev_events[(index - 1) / 2];
+	index = (index - 1) / 2;
+    }
+    dev_events[index] = event;
+}
+
+/*
+ *  Schedule an interrupt for a given number of device ticks in the
+ *  future (at least one). When several interrupts are due on the same
+ *  tick, the one from the higher priority device goes first.
  */
 dynamic_fun void schedule_int(int device, void *arg, int future_time)
 {
-    unsigned char index;	/* index MUST be char for wrap */
-    int 	low_pri_dev;
-    void 	*low_pri_arg;
+    int		enabled;
+
+    if (future_time < 1)
+	future_time = 1;
 
-    index = ((unsigned char) future_time) + dev_event_ptr;
-    do
+    enabled = int_off();
+    push_event(dev_tick + (unsigned long) future_time * DEV_TICK, device, arg);
+    if (enabled) {
+	int_on();
+    }
+}
+
+/*
+ *  Removes the first event from the queue, if it is due by the given
+ *  tick. Returns FALSE (leaving the queue alone) if it isn't.
+ */
+static int next_event(unsigned long now, dev_event *event)
+{
+    dev_event	last;
+    int		index;
+    int		child;
+
+    if (num_dev_events == 0 || dev_events[0].time > now)
+	return FALSE;
+    *event = dev_events[0];
+
+    /*  Sift the last event down from the root */
+    last = dev_events[--num_dev_events];
+    index = 0;
+    while ((child = 2 * index + 1) < num_dev_events)
     {
-	/*  Loop until we find a lower priority device than current */
-	while(dev_event_queue[index].device <= device)
-	    index++;
-	/*  Swap the lower with the higher and continue */
-	low_pri_dev = dev_event_queue[index].device;
-	low_pri_arg = dev_event_queue[index].arg;
-	dev_event_queue[index].device = device;
-	dev_event_queue[index].arg = arg;
-	device = low_pri_dev;
-	arg = low_pri_arg;
+	if (child + 1 < num_dev_events &&
+	    event_before(&dev_events[child + 1], &dev_events[child]))
+	    child++;
+	if (!event_before(&dev_events[child], &last))
+	    break;
+	dev_events[index] = dev_events[child];
+	index = child;
     }
-    while(low_pri_dev != LOW_PRI_DEV);
+    dev_events[index] = last;
+    return TRUE;
 }
 
 /*
- *  Gets the next event from the queue at interrupt time and performs
- *  all processing needed for this interrupt - calling the device
- *  action routine and the user interrupt handler.
+ *  Performs all processing needed for one event - calling the device
+ *  action routine and the user interrupt handler. The clock and the
+ *  terminal poll are rescheduled first, so they stay periodic even if
+ *  the handler switches to another process.
  */
-dynamic_fun void dispatch_int(void)
+static void deliver_event(dev_event *event)
 {
-    static unsigned int tick = 0;
-    int event_device;
+    int event_device = event->device;
     int unit_num = -1;
-    void *arg;
+    void *arg = event->arg;
 
-    /*  Update and check the 'tick' variable to see if this is a clock
-	interrupt */
-    tick = ~tick;
-    if (tick)
+    switch(event_device)
     {
+      case USLOSS_CLOCK_DEV:
+        push_event(dev_tick + CLOCK_PERIOD, USLOSS_CLOCK_DEV, NULL);
         LOG(CLOCK_VERBOSITY, "Interrupt: %d (CLOCK), handler @ %p\n",
             USLOSS_CLOCK_INT, USLOSS_IntVec[USLOSS_CLOCK_INT]);
         clock_action();
@@ -90,18 +189,6 @@ dynamic_fun void dispatch_int(void)
 
         (*USLOSS_IntVec[USLOSS_CLOCK_INT])(USLOSS_CLOCK_DEV, 0);
         return;
-    }
-
-    /*  This is not a clock interrupt - get the next event (from a device) */
-    dev_event_ptr++;
-    event_device = dev_event_queue[dev_event_ptr].device;
-    arg = dev_event_queue[dev_event_ptr].arg;
-
-    /*  Reset the queue entry to the terminal device and perform the
-	action for this device */
-    dev_event_queue[dev_event_ptr].device = LOW_PRI_DEV;
-    switch(event_device)
-    {
       case USLOSS_ALARM_DEV:
     LOG(INT_VERBOSITY, "Interrupt: %d (ALARM), handler @ %p\n", event_device,
         USLOSS_IntVec[event_device]);
@@ -113,6 +200,7 @@ dynamic_fun void dispatch_int(void)
 	unit_num = disk_action(arg);
 	break;
       case USLOSS_TERM_DEV:
+	push_event(dev_tick + TERM_POLL_PERIOD, USLOSS_TERM_DEV, NULL);
     LOG(INT_VERBOSITY, "Interrupt: %d (TERM), handler @ %p\n", event_device,
         USLOSS_IntVec[event_device]);
 	unit_num = term_action(arg);
@@ -121,8 +209,8 @@ dynamic_fun void dispatch_int(void)
         {
 	    char msg[60];
 
-	    sprintf(msg, "illegal device number %d in event queue, index %u",
-		event_device, dev_event_ptr);
+	    sprintf(msg, "illegal device number %d in event queue, tick %lu",
+		event_device, dev_tick);
 	    usloss_usr_assert(0, msg);
 	}
     }
@@ -139,6 +227,25 @@ dynamic_fun void dispatch_int(void)
     }
 }
 
+/*
+ *  Called on every alarm signal to perform all processing for the
+ *  device events due by now.
+ */
+dynamic_fun void dispatch_int(void)
+{
+    dev_event event;
+
+    /*  Deliver every event that is due by this tick, in priority order.
+	A handler may switch to another process; the events are already
+	off the queue, and the loop picks up where it left off (or
+	another signal does) when this process runs again. */
+    dev_tick++;
+    while (next_event(dev_tick, &event))
+    {
+	deliver_event(&event);
+    }
+}
+
 /*
  *  Perform the inp() operation, which returns the status of a device.  We
  *  call on a per-device basis because the device may clear its status when
@@ -21,6 +21,8 @@ dynamic_dcl int dumpcore;
 #define USLOSS_PSR_MAGIC 0x45200
 
 extern int virtual_time;
+extern int fast_trap;       /* USLOSS_Syscall skips the SIGUSR1 round trip */
+extern int fast_switch;     /* USLOSS_ContextSwitch uses _setjmp/_longjmp */
 extern int SIG_ALARM;
 
 #define TRUE 1
@@ -31,6 +31,8 @@ static void print_options()
     printf("  -h, --help               Print list of options and exit.\n");
     printf("  -r, --real-time          Set USLOSS to use real time. This is the default mode.\n");
     printf("  -R, --virtual-time       Set USLOSS to use virtual time.\n");
+    printf("  -f, --fast-trap          Make system calls without raising a signal.\n");
+    printf("  -s, --fast-switch        Switch contexts with _setjmp/_longjmp instead of swapcontext.\n");
     printf("  -v, --verbose            Increase the verbosity level of USLOSS. The verbosity level\n");
     printf("                           is equal to the number of times this option is set.\n");
     printf("                           LEVELS:\n");
@@ -41,21 +43,26 @@ static void print_options()
 }
 
 // global flags
-int verbosity, virtual_time, SIG_ALARM;
+int verbosity, virtual_time, fast_trap, fast_switch, SIG_ALARM;
 
 int main(int argc, char **argv)
 {
     // Parse args
     verbosity = 0;
     virtual_time = FALSE;
+    fast_trap = FALSE;
+    fast_switch = FALSE;
     int opt;
     struct option longopt[] = {
         {"verbose", no_argument, NULL, 'v'},
         {"real-time", no_argument, NULL, 'r'},
         {"virtual-time", no_argument, NULL, 'R'},
-        {"help", no_argument, NULL, 'h'}
+        {"fast-trap", no_argument, NULL, 'f'},
+        {"fast-switch", no_argument, NULL, 's'},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0}
     };
-    while ((opt = getopt_long(argc, argv, "vrRh", longopt, NULL)) != -1) {
+    while ((opt = getopt_long(argc, argv, "vrRfsh", longopt, NULL)) != -1) {
         switch(opt) {
             case 'v':
                 verbosity++;
@@ -66,6 +73,12 @@ int main(int argc, char **argv)
             case 'R':
                 virtual_time = TRUE;
                 break;
+            case 'f':
+                fast_trap = TRUE;
+                break;
+            case 's':
+                fast_switch = TRUE;
+                break;
             case 'h':
                 print_options();
                 return 0;
@@ -1,5 +1,9 @@
+/*  _longjmp from one context's stack to another's trips glibc's fortify
+    check (__longjmp_chk), so keep it off in this file */
+#undef _FORTIFY_SOURCE
 #include <stdio.h>
 #include <signal.h>
+#include <setjmp.h>
 #include <unistd.h>
 #include <assert.h>
 #include <stdlib.h>
@@ -26,10 +30,104 @@ static void             *syscall_arg = NULL;
 #define ILLEGAL_PENDING 2
 static int              trap_pending = 0;
 
+/*
+ * Software interrupt mask. SIG_ALARM and SIGUSR1 are never blocked in the
+ * host's signal mask; instead int_off() sets soft_masked, and sighandler
+ * only notes a SIG_ALARM that arrives while it is set. int_on() clears it
+ * and replays the noted alarm, so disabling and enabling interrupts costs
+ * no host syscalls. Like a blocked signal, several alarms that arrive
+ * while masked are delivered as one.
+ */
+static volatile sig_atomic_t    soft_masked = 0;
+static volatile sig_atomic_t    alarm_pending = 0;
+
 struct sigaction        old_actions[NUM_SIG];
 
 static USLOSS_Context           *launch_context;
 
+/*
+ * State for the --fast-switch context switch backend. A context that has
+ * been switched away from is resumed with _longjmp, which (unlike
+ * swapcontext) doesn't touch the host signal mask; that is safe now that
+ * interrupts are masked in software, so the host mask never changes. A
+ * context that has never run is still launched with setcontext, once.
+ *
+ * USLOSS_Context can't grow without breaking code already compiled
+ * against it, so the jump buffers live in this table, keyed by the
+ * context's address. Contexts that don't fit fall back to swapcontext.
+ */
+#define NUM_JMP_CONTEXTS 1024
+
+typedef struct JmpContext {
+    USLOSS_Context      *ctx;
+    int                 saved;      /* buf holds the context's state */
+    jmp_buf             buf;
+} JmpContext;
+
+static JmpContext       jmp_contexts[NUM_JMP_CONTEXTS];
+
+/*
+ *  Finds (or adds) the table entry for a context. Returns NULL if the
+ *  table is full.
+ */
+static JmpContext *jmp_context(USLOSS_Context *ctx)
+{
+    unsigned long hash = ((unsigned long) ctx >> 4) % NUM_JMP_CONTEXTS;
+    int i;
+
+    for (i = 0; i < NUM_JMP_CONTEXTS; i++) {
+        JmpContext *entry = &jmp_contexts[(hash + i) % NUM_JMP_CONTEXTS];
+        if (entry->ctx == ctx) {
+            return entry;
+        }
+        if (entry->ctx == NULL) {
+            entry->ctx = ctx;
+            entry->saved = 0;
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+/*
+ *  Switches to new_context with the --fast-switch backend, saving the
+ *  current state for old_context (if any) first. Returns once old_context
+ *  is switched back to.
+ */
+static void jmp_switch(USLOSS_Context *old_context, USLOSS_Context *new_context)
+{
+    JmpContext *old_entry;
+    JmpContext *new_entry;
+    volatile int resumed = FALSE;
+    int err_return;
+
+    if (old_context != NULL) {
+        old_entry = jmp_context(old_context);
+        if (old_entry == NULL) {
+            /*  No room in the table - save it the slow way, where
+                setcontext will find it */
+            err_return = getcontext(&old_context->context);
+            usloss_sys_assert(err_return != -1, "getcontext failed in USLOSS_ContextSwitch");
+            if (resumed) {
+                return;
+            }
+            resumed = TRUE;
+        } else {
+            if (_setjmp(old_entry->buf) != 0) {
+                return;         /*  Switched back to */
+            }
+            old_entry->saved = 1;
+        }
+    }
+
+    new_entry = jmp_context(new_context);
+    if (new_entry != NULL && new_entry->saved) {
+        _longjmp(new_entry->buf, 1);
+    }
+    err_return = setcontext(&new_context->context);
+    usloss_sys_assert(err_return != -1, "context swap error in USLOSS_ContextSwitch");
+}
+
 /*  
  *  Timer setup code.
  */
@@ -102,6 +200,12 @@ void USLOSS_ContextInit(USLOSS_Context *ctx, char *stack, int stackSize, USLOSS_
     ctx->context.uc_link = NULL;
     ctx->pageTable = pageTable;
     makecontext(&ctx->context, launcher, 0);
+    if (fast_switch) {
+        JmpContext *entry = jmp_context(ctx);
+        if (entry != NULL) {
+            entry->saved = 0;   /*  Must be launched from the ucontext */
+        }
+    }
     ctx->start = pc;
     if (enabled) {
         int_on();
@@ -113,9 +217,19 @@ void USLOSS_ContextInit(USLOSS_Context *ctx, char *stack, int stackSize, USLOSS_
  */
 static void sighandler(int sig, siginfo_t *sigstuff, void *oldcontext)
 {
-    int old_psr = current_psr;
+    int old_psr;
+    int was_masked;
     void *arg;
 
+    /*  Interrupts are disabled - hold the alarm until int_on() */
+    if (sig == SIG_ALARM && soft_masked) {
+        alarm_pending = 1;
+        return;
+    }
+    was_masked = soft_masked;
+    soft_masked = 1;
+    old_psr = current_psr;
+
     /*  We are now in kernel mode - set psr accordingly */
 
     psr_valid();
@@ -187,6 +301,9 @@ done:
         usloss_assert(0, "corrupted psr");
     }
     current_psr = old_psr;
+    if (!was_masked) {
+        int_on();
+    }
 #ifdef MMU
     if (mmuInTouch) {
         siglongjmp(mmuTouchBuf, 1);
@@ -233,7 +350,11 @@ void USLOSS_ContextSwitch(USLOSS_Context *old_context, USLOSS_Context *new_conte
             }
         }
     }
-    if (old_context == NULL) {
+    if (fast_switch) {
+        check_interrupts();
+        jmp_switch(old_context, new_context);
+        err_return = 0;
+    } else if (old_context == NULL) {
         err_return = setcontext(&new_context->context);
     } else {
         check_interrupts();
@@ -250,44 +371,35 @@ void USLOSS_ContextSwitch(USLOSS_Context *old_context, USLOSS_Context *new_conte
  *  Interrupt enable/disable/check section
  */
 
-static sigset_t timer_set;
-
 /*
- *  This is called to block delivery of SIG_ALARM to the process, thereby
- *  disabling USLOSS interrupts.
+ *  This is called to disable USLOSS interrupts. It returns TRUE if they
+ *  were enabled before.
  */
 
 int int_off(void)
 {
-    int err_return;
     int enabled;
-    sigset_t cur_set;
 
-    err_return = sigprocmask(SIG_BLOCK, &timer_set, &cur_set);
-    usloss_sys_assert(err_return != -1, "error disabling interrupts");
-    enabled = sigismember(&cur_set, SIG_ALARM) ? FALSE : TRUE;
+    enabled = soft_masked ? FALSE : TRUE;
+    soft_masked = 1;
     return enabled;
 }
 
 /*
- *  This is called to permit delivery of SIG_ALARM to the process, thereby
- *  enabling USLOSS interrupts.
+ *  This is called to enable USLOSS interrupts, delivering any alarm that
+ *  arrived while they were disabled.
  *
- *  I modified the timer_set to include SIGUSR1, otherwise when switching to a new context
- *  from an interrupt handler and enabling interrupts SIGUSR1 could be left blocked because
- *  it is in the sa_mask and therefore blocked when the signal handler is invoked. Something
- *  must have changed in the way Linux/Unix handles signal masks. JHH 3/9/09
+ *  The mask is cleared before alarm_pending is checked: an alarm that
+ *  arrives in between is handled directly, and one that arrived earlier
+ *  has already set alarm_pending by the time we look.
  */
 void int_on(void) 
 {
-    int err_return;
-    sigset_t cur_set;
-
-    err_return = sigprocmask(SIG_UNBLOCK, &timer_set, NULL);
-    usloss_sys_assert(err_return != -1, "error enabling interrupts");
-    err_return = sigprocmask(SIG_BLOCK, NULL, &cur_set);
-    usloss_sys_assert(err_return != -1, "error checking signals");
-    usloss_sys_assert(sigismember(&cur_set, SIGUSR1) == 0, "SIGUSR1 is blocked");
+    soft_masked = 0;
+    if (alarm_pending) {
+        alarm_pending = 0;
+        raise(SIG_ALARM);
+    }
 }
 
 
@@ -311,6 +423,49 @@ void USLOSS_WaitInt(void)
     }
 }
 
+/*
+ * Fast-trap version of USLOSS_Syscall, used when USLOSS is started with
+ * --fast-trap. Instead of raising SIGUSR1 it does what sighandler would
+ * do, right here on the caller's stack: mask interrupts (as sighandler
+ * does on entry), switch the PSR to kernel mode, call the syscall vector,
+ * then restore the PSR and unmask interrupts (as sighandler does on
+ * exit). An interrupt that arrives during the call is held until the
+ * handler enables interrupts or the call returns, exactly as before.
+ */
+static void fast_syscall(void *arg)
+{
+    int enabled;
+    unsigned int old_psr;
+
+    enabled = int_off();
+    if (enabled == FALSE) {
+        USLOSS_Console("INTERNAL ERROR: USLOSS_Syscall: invoked with interrupts blocked.\n");
+        abort();
+    }
+    old_psr = current_psr;
+
+    psr_valid();
+    current_psr = USLOSS_PSR_MAGIC | ((current_psr & USLOSS_PSR_CURRENT_MASK) << 2);
+    current_psr |= USLOSS_PSR_CURRENT_MODE;
+
+    if (USLOSS_IntVec[USLOSS_SYSCALL_INT] == NULL) {
+        rpt_sim_trap("USLOSS_IntVec[USLOSS_SYSCALL_INT] is NULL!\n");
+    }
+    LOG(INT_VERBOSITY, "Interrupt: %d (SYSCALL %d, fast trap), handler @ %p\n",
+        USLOSS_SYSCALL_INT, arg == NULL ? -1 : ((USLOSS_Sysargs*)arg)->number,
+        USLOSS_IntVec[USLOSS_SYSCALL_INT]);
+    (*USLOSS_IntVec[USLOSS_SYSCALL_INT])(USLOSS_SYSCALL_INT, arg);
+
+    /*  The handler may have enabled interrupts; block them again while the
+        PSR is put back, just as sighandler does before it returns */
+    (void) int_off();
+    if ((current_psr & ~USLOSS_PSR_MASK) != USLOSS_PSR_MAGIC) {
+        usloss_assert(0, "corrupted psr");
+    }
+    current_psr = old_psr;
+    int_on();
+}
+
 /*
  * System call. The trap_pending flag is a total hack. Without it
  * a SIG_ALARM signal might show up after the SIGUSR1 signal has been
@@ -321,22 +476,19 @@ void USLOSS_WaitInt(void)
  */
 void USLOSS_Syscall(void *arg)
 {
-    int err_return;
-    int enabled;
-    sigset_t cur_set;
-
     if (current_psr & USLOSS_PSR_CURRENT_MODE) {
         USLOSS_Console("FATAL ERROR: Invoking USLOSS_Syscall from kernel mode.\n");
         abort();
     }
+    if (fast_trap) {
+        fast_syscall(arg);
+        return;
+    }
     /*
-     * Make sure SIGUSR1 is not blocked.
+     * Make sure interrupts are not disabled.
      */
-    err_return = sigprocmask(SIG_BLOCK, NULL, &cur_set);
-    usloss_sys_assert(err_return != -1, "error checking signal mask");
-    enabled = sigismember(&cur_set, SIGUSR1) ? FALSE : TRUE;
-    if (enabled == FALSE) {
-        USLOSS_Console("INTERNAL ERROR: USLOSS_Syscall: invoking raise() with SIGUSR1 blocked.\n");
+    if (soft_masked) {
+        USLOSS_Console("INTERNAL ERROR: USLOSS_Syscall: invoking raise() with interrupts disabled.\n");
         abort();
     }
     trap_pending = SYSCALL_PENDING;
@@ -346,22 +498,15 @@ void USLOSS_Syscall(void *arg)
 
 void USLOSS_IllegalInstruction(void)
 {
-    int err_return;
-    int enabled;
-    sigset_t cur_set;
-
     if (current_psr & USLOSS_PSR_CURRENT_MODE) {
         USLOSS_Console("FATAL ERROR: Invoking USLOSS_IllegalInstruction from kernel mode.\n");
         abort();
     }
     /*
-     * Make sure SIGUSR1 is not blocked.
+     * Make sure interrupts are not disabled.
      */
-    err_return = sigprocmask(SIG_BLOCK, NULL, &cur_set);
-    usloss_sys_assert(err_return != -1, "error checking signal mask");
-    enabled = sigismember(&cur_set, SIGUSR1) ? FALSE : TRUE;
-    if (enabled == FALSE) {
-        USLOSS_Console("INTERNAL ERROR: USLOSS_IllegalInstruction: invoking raise() with SIGUSR1 blocked.\n");
+    if (soft_masked) {
+        USLOSS_Console("INTERNAL ERROR: USLOSS_IllegalInstruction: invoking raise() with interrupts disabled.\n");
         abort();
     }
     trap_pending = ILLEGAL_PENDING;
@@ -382,16 +527,12 @@ void sig_ints_init(void)
     new_act.sa_flags = SA_SIGINFO;
     /*
      * We want to contine to receive SIGSEGV signals, even in a signal
-     * handler, so don't defer them. The other signals are in the sa_mask
-     * so they will be blocked.
+     * handler, so don't defer them. SIG_ALARM and SIGUSR1 aren't blocked
+     * either; sighandler sets the software mask instead (see int_off).
      */
     new_act.sa_flags |= SA_NODEFER;
     err_return = sigemptyset(&new_act.sa_mask);
     usloss_sys_assert(err_return != -1, "error creating empty  signal set");
-    err_return = sigaddset(&new_act.sa_mask, SIG_ALARM);
-    usloss_sys_assert(err_return != -1, "error adding SIG_ALARM to set");
-    err_return = sigaddset(&new_act.sa_mask, SIGUSR1);
-    usloss_sys_assert(err_return != -1, "error adding SIGUSR1 to set");
 
     err_return = sigaction(SIG_ALARM, &new_act, &old_actions[SIG_ALARM]);
     usloss_sys_assert(err_return != -1, "error setting up SIG_ALARM action");
@@ -403,14 +544,7 @@ void sig_ints_init(void)
     err_return = sigaction(SIGBUS, &new_act, &old_actions[SIGBUS]);
     usloss_sys_assert(err_return != -1, "error setting up SIGBUS action");
 #endif
-    /*  Set up the timer_set (used for enabling and disabling interrupts) and
-        disable those interrupts */
-    err_return = sigemptyset(&timer_set);
-    usloss_sys_assert(err_return != -1, "error creating empty timer set");
-    err_return = sigaddset(&timer_set, SIG_ALARM);
-    usloss_sys_assert(err_return != -1, "error adding SIG_ALARM to timer set");
-    err_return = sigaddset(&timer_set, SIGUSR1);
-    usloss_sys_assert(err_return != -1, "error adding SIGUSR1 to timer set");
+    /*  Start with interrupts disabled */
     (void) int_off();
     set_timer();
 }